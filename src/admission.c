@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(admission, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/mfd/npm1300.h>
+#include <modem/lte_lc.h>
+#include <nrf_modem_at.h>
+#include "admission.h"
+#include "supercap.h"
+
+#define FLOOR_MV    (CONFIG_SUPERCAP_CUTOFF_MV + CONFIG_ADMISSION_BROWNOUT_MARGIN_MV)
+#define RECOVER_MV  (FLOOR_MV + CONFIG_ADMISSION_RECOVERY_HYSTERESIS_MV)
+
+#if defined(CONFIG_ADMISSION_PMIC_POF)
+#define ZEPHYR_USER DT_PATH(zephyr_user)
+
+BUILD_ASSERT(DT_NODE_HAS_PROP(ZEPHYR_USER, pof_gpios),
+	     "ADMISSION_PMIC_POF needs pof-gpios in the zephyr,user node");
+
+#define NPM1300_GPIOS_BASE         0x06
+#define NPM1300_GPIO_MODE_PLW      7	/* Power-loss warning output */
+#define NPM1300_POF_BASE           0x09
+#define NPM1300_POF_OFFSET_CONFIG  0x00
+#define NPM1300_POF_ENABLE         BIT(0)
+#define NPM1300_POF_ACTIVE_HIGH    BIT(1)
+/* VSYS threshold, 2.6 V to 3.5 V in 100 mV steps */
+#define NPM1300_POF_THRESHOLD(mv)  ((((mv) - 2600) / 100) << 2)
+
+static const struct device *pmic = DEVICE_DT_GET(DT_INST(0, nordic_npm1300));
+static const struct gpio_dt_spec pof_gpio = GPIO_DT_SPEC_GET(ZEPHYR_USER, pof_gpios);
+static struct gpio_callback pof_cb;
+#endif
+
+/* Cost assumed until the ledger has measured the operation */
+static const uint32_t default_cost_mj[ENERGY_LEDGER_OP_COUNT] = {
+	[ENERGY_LEDGER_OP_CONNECT] = CONFIG_ADMISSION_CONNECT_COST_MJ,
+	[ENERGY_LEDGER_OP_SENSOR_READ] = 0,
+	[ENERGY_LEDGER_OP_TX] = CONFIG_ADMISSION_TX_COST_MJ,
+	[ENERGY_LEDGER_OP_CELL_MEAS] = CONFIG_ADMISSION_CELL_MEAS_COST_MJ,
+	[ENERGY_LEDGER_OP_LOCATION] = CONFIG_ADMISSION_LOCATION_COST_MJ,
+};
+
+static atomic_t brownout;
+
+static bool op_is_essential(enum energy_ledger_op op)
+{
+	return op == ENERGY_LEDGER_OP_CONNECT || op == ENERGY_LEDGER_OP_TX;
+}
+
+static float op_cost_mj(enum energy_ledger_op op)
+{
+	struct energy_ledger_entry entry;
+
+	energy_ledger_get(op, &entry);
+
+	/* A negative mean means harvest covered the load, keep the default */
+	if (entry.count > 0 && entry.total_mj > 0.f) {
+		return entry.total_mj / entry.count;
+	}
+
+	return (float)default_cost_mj[op];
+}
+
+static void brownout_set(const char *source)
+{
+	if (!atomic_set(&brownout, 1)) {
+		LOG_WRN("Brownout latch set by %s", source);
+	}
+}
+
+void admission_voltage_update(float voltage)
+{
+	int32_t mv = (int32_t)(voltage * 1000.f);
+
+	if (mv < FLOOR_MV) {
+		brownout_set("fuel gauge");
+	} else if (mv >= RECOVER_MV && atomic_cas(&brownout, 1, 0)) {
+		LOG_INF("Brownout latch cleared at %d mV", mv);
+	}
+}
+
+/* Cost of count operations, with the margin. An optional operation also
+ * keeps one uplink in reserve, so it never takes the energy the sensor
+ * data needs.
+ */
+static float cost_with_margin_mj(enum energy_ledger_op op, uint32_t count)
+{
+	float cost_mj = op_cost_mj(op) * count;
+
+	if (!op_is_essential(op)) {
+		cost_mj += op_cost_mj(ENERGY_LEDGER_OP_TX);
+	}
+
+	return cost_mj * (float)CONFIG_ADMISSION_COST_MARGIN_PCT / 100.f;
+}
+
+enum admission_verdict admission_check(enum energy_ledger_op op, uint32_t count)
+{
+	enum admission_verdict refused = op_is_essential(op) ? ADMISSION_DEFER : ADMISSION_DROP;
+	float cost_mj;
+	float available_mj;
+
+	if (op >= ENERGY_LEDGER_OP_COUNT) {
+		return ADMISSION_ADMIT;
+	}
+
+	if (atomic_get(&brownout)) {
+		LOG_INF("%s refused: brownout latch set", energy_ledger_op_str(op));
+		return refused;
+	}
+
+	cost_mj = cost_with_margin_mj(op, count);
+	available_mj = supercap_energy_above((float)FLOOR_MV / 1000.f) * 1000.f;
+
+	if (available_mj >= cost_mj) {
+		return ADMISSION_ADMIT;
+	}
+
+	/* Uplinks shrink to the current sample before they are deferred */
+	if (op == ENERGY_LEDGER_OP_TX && count > 1 &&
+	    available_mj >= cost_with_margin_mj(op, 1)) {
+		LOG_INF("%s degraded: %u need %.0f mJ, %.0f mJ available",
+			energy_ledger_op_str(op), count, (double)cost_mj, (double)available_mj);
+		return ADMISSION_DEGRADE;
+	}
+
+	LOG_INF("%s refused: needs %.0f mJ, %.0f mJ available", energy_ledger_op_str(op),
+		(double)cost_mj, (double)available_mj);
+	return refused;
+}
+
+#if defined(CONFIG_LTE_LC_MODEM_EVENTS_MODULE)
+static void lte_modem_evt_handler(const struct lte_lc_evt *const evt)
+{
+	if (evt->type == LTE_LC_EVT_MODEM_EVENT &&
+	    evt->modem_evt.type == LTE_LC_MODEM_EVT_BATTERY_LOW) {
+		brownout_set("modem battery-low event");
+	}
+}
+#endif
+
+#if defined(CONFIG_ADMISSION_PMIC_POF)
+static void pof_handler(const struct device *port, struct gpio_callback *cb, uint32_t pins)
+{
+	brownout_set("PMIC power-fail warning");
+}
+
+/* The nPM1300 raises no event for the warning, it drives one of its GPIOs */
+static int pof_init(void)
+{
+	int err;
+
+	if (!device_is_ready(pmic) || !gpio_is_ready_dt(&pof_gpio)) {
+		return -ENODEV;
+	}
+
+	err = mfd_npm1300_reg_write(pmic, NPM1300_GPIOS_BASE, CONFIG_ADMISSION_PMIC_POF_GPIO,
+				    NPM1300_GPIO_MODE_PLW);
+	if (err) {
+		return err;
+	}
+
+	err = mfd_npm1300_reg_write(pmic, NPM1300_POF_BASE, NPM1300_POF_OFFSET_CONFIG,
+				    NPM1300_POF_ENABLE | NPM1300_POF_ACTIVE_HIGH |
+				    NPM1300_POF_THRESHOLD(CONFIG_ADMISSION_PMIC_POF_MV));
+	if (err) {
+		return err;
+	}
+
+	err = gpio_pin_configure_dt(&pof_gpio, GPIO_INPUT);
+	if (err) {
+		return err;
+	}
+
+	gpio_init_callback(&pof_cb, pof_handler, BIT(pof_gpio.pin));
+	err = gpio_add_callback(pof_gpio.port, &pof_cb);
+	if (err) {
+		return err;
+	}
+
+	return gpio_pin_interrupt_configure_dt(&pof_gpio, GPIO_INT_EDGE_TO_ACTIVE);
+}
+#endif
+
+/* Must run after the modem library is initialized */
+int admission_init(void)
+{
+	int err;
+
+#if defined(CONFIG_ADMISSION_PMIC_POF)
+	err = pof_init();
+	if (err) {
+		LOG_ERR("Unable to set up the PMIC power-fail warning: %d", err);
+		return err;
+	}
+#endif
+
+#if defined(CONFIG_LTE_LC_MODEM_EVENTS_MODULE)
+
+	lte_lc_register_handler(lte_modem_evt_handler);
+
+	err = nrf_modem_at_printf("AT%%XVBATLOWLVL=%d", CONFIG_ADMISSION_MODEM_VBAT_LOW_MV);
+	if (err) {
+		LOG_ERR("Unable to set modem battery-low level: %d", err);
+		return err;
+	}
+
+	err = lte_lc_modem_events_enable();
+	if (err) {
+		LOG_ERR("Unable to enable modem events: %d", err);
+		return err;
+	}
+#else
+	ARG_UNUSED(err);
+#endif
+
+	return 0;
+}
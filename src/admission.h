@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __ADMISSION_H__
+#define __ADMISSION_H__
+
+/** Energy admission control for radio operations.
+ *
+ * Before an LTE connect, an uplink or a location request starts, its cost is
+ * compared with the supercapacitor energy stored above the brownout floor
+ * (`CONFIG_SUPERCAP_CUTOFF_MV` + `CONFIG_ADMISSION_BROWNOUT_MARGIN_MV`). The
+ * cost is the mean measured by the energy ledger (see energy_ledger.h), or a
+ * Kconfig default until the operation has been measured, with a safety
+ * margin on top.
+ *
+ * The check itself never touches the PMIC. A brownout latch is set by the
+ * modem battery-low event (%XVBATLOWLVL), by the fuel gauge update when the
+ * voltage crosses the floor and, with `CONFIG_ADMISSION_PMIC_POF`, by the
+ * nPM1300 VSYS power-fail warning. It is cleared once the voltage recovers
+ * above the floor plus a hysteresis. While latched nothing is admitted.
+ *
+ * Optional operations (cell measurement, location) also keep the cost of one
+ * uplink in reserve. An uplink of several messages that only one fits is
+ * degraded: the current sample goes out on its own and the queue drain waits.
+ * Essential operations (connect, uplink) that are refused should be deferred,
+ * optional ones dropped, as the verdict says.
+ */
+
+#include <stdint.h>
+#include "energy_ledger.h"
+
+enum admission_verdict {
+	ADMISSION_ADMIT,
+	ADMISSION_DEGRADE,	/* Uplink only: send the current sample alone */
+	ADMISSION_DEFER,
+	ADMISSION_DROP,
+};
+
+int admission_init(void);
+enum admission_verdict admission_check(enum energy_ledger_op op, uint32_t count);
+void admission_voltage_update(float voltage);
+
+#endif /* __ADMISSION_H__ */
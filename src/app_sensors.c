@@ -15,29 +15,108 @@ LOG_MODULE_REGISTER(app_sensors, LOG_LEVEL_DBG);
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <date_time.h>
+#include <math.h>
 #include <stdio.h>
 #include <zephyr/drivers/sensor.h>
 #include "app_sensors.h"
+#include "app_settings.h"
 #include "fuel_gauge.h"
+#include "sample_store.h"
+#include "sampler.h"
+#include "supercap.h"
+#include "energy_ledger.h"
+#include "scheduler.h"
+#include "admission.h"
+#include "retained.h"
+#include "boot_timing.h"
+#include "conn_mgr.h"
 #include <helpers/nrfx_reset_reason.h>
 #include <modem/modem_info.h>
 
-#define NUM_SENSOR_KEY_VALUE_PAIRS   2
+#define NUM_SENSOR_KEY_VALUE_PAIRS   6
 #define MODEM_MAP_ENTRIES            4
 #define BATTERY_MAP_ENTRIES          5
-
-#define JSON_FMT "{\"rst_reason\":%d}"
+#define STATS_MAP_ENTRIES            5
+#define SUPERCAP_MAP_ENTRIES         3
+#define KEY_MAX_LEN                  8
+
+/* Integer map keys of the compact telemetry schema (see app_sensors.h) */
+#define COMPACT_SCHEMA_VERSION       1
+
+enum sample_key {
+	SAMPLE_KEY_SCHEMA = 0,
+	SAMPLE_KEY_TS = 1,
+	SAMPLE_KEY_MODEM = 2,
+	SAMPLE_KEY_BATTERY = 3,
+	SAMPLE_KEY_STATS = 4,
+	SAMPLE_KEY_SUPERCAP = 5,
+};
+
+enum modem_key {
+	MODEM_KEY_VBAT = 0,
+	MODEM_KEY_TEMP = 1,
+	MODEM_KEY_SUCCESS = 2,
+	MODEM_KEY_FAIL = 3,
+};
+
+enum stats_key {
+	STATS_KEY_COUNT = 0,
+	STATS_KEY_VOLTAGE = 1,
+	STATS_KEY_CURRENT = 2,
+	STATS_KEY_SOC = 3,
+	STATS_KEY_DROPPED = 4,
+};
+
+enum supercap_key {
+	SUPERCAP_KEY_USABLE = 0,
+	SUPERCAP_KEY_CYCLES_LEFT = 1,
+	SUPERCAP_KEY_CYCLE_COST = 2,
+};
+
+enum battery_key {
+	BATTERY_KEY_VOLTAGE = 0,
+	BATTERY_KEY_CURRENT = 1,
+	BATTERY_KEY_SOC = 2,
+	BATTERY_KEY_TTE = 3,
+	BATTERY_KEY_TTF = 4,
+};
+
+#if defined(CONFIG_TELEMETRY_COMPACT_SCHEMA)
+#define put_key(zse, key, name) zcbor_uint32_put(zse, key)
+#else
+#define put_key(zse, key, name) zcbor_tstr_put_lit(zse, name)
+#endif
+
+/* Worst-case CBOR size of one encoded sample */
+#define SAMPLE_CBOR_MAX_SIZE         320
+
+#define SENSOR_ENDP                  "sensor"
+#define SENSOR_BATCH_ENDP            "batch"
+
+/* Largest CBOR array sent to the batch endpoint */
+#if defined(CONFIG_SAMPLE_BATCH) && defined(CONFIG_SAMPLE_STORE)
+#define BATCH_MAX_SAMPLES MAX(CONFIG_SAMPLE_BATCH_MAX_SIZE, CONFIG_SAMPLE_STORE_DRAIN_BATCH)
+#elif defined(CONFIG_SAMPLE_BATCH)
+#define BATCH_MAX_SAMPLES CONFIG_SAMPLE_BATCH_MAX_SIZE
+#elif defined(CONFIG_SAMPLE_STORE)
+#define BATCH_MAX_SAMPLES CONFIG_SAMPLE_STORE_DRAIN_BATCH
+#else
+#define BATCH_MAX_SAMPLES 1
+#endif
+
+typedef int (*sample_source_fn)(size_t index, struct sensor_sample *sample);
+
+#define JSON_FMT "{\"rst_reason\":%d,\"boot_count\":%u,\"boot_ms\":%s}"
 
 static struct golioth_client *client;
 
-static uint32_t tx_success_counter = 0;
-static uint32_t tx_failure_counter = 0;
-
 /* Callback for LightDB Stream */
 void async_error_handler(struct golioth_client *client, enum golioth_status status,
 						 const struct golioth_coap_rsp_code *coap_rsp_code, const char *path,
 						 void *arg)
 {
+	conn_mgr_request_done();
+
 	if (status != GOLIOTH_OK)
 	{
 		LOG_ERR("Async task failed: %d", status);
@@ -45,51 +124,90 @@ void async_error_handler(struct golioth_client *client, enum golioth_status stat
 	}
 }
 
+/* Callback for the sensor stream, closes the TX energy measurement */
+static void sensor_stream_handler(struct golioth_client *client, enum golioth_status status,
+				  const struct golioth_coap_rsp_code *coap_rsp_code,
+				  const char *path, void *arg)
+{
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_end(ENERGY_LEDGER_OP_TX);));
+
+	async_error_handler(client, status, coap_rsp_code, path, arg);
+}
+
 uint32_t app_sensors_get_tx_success_count(void)
 {
-	return tx_success_counter;
+	return retained_get_u32(RETAINED_TX_SUCCESS);
 }
 
 uint32_t app_sensors_get_tx_failure_count(void)
 {
-	return tx_failure_counter;
+	return retained_get_u32(RETAINED_TX_FAILURE);
 }
 
-static enum golioth_status read_modem_data(zcbor_state_t *zse)
+static int read_modem_data(struct sensor_sample *sample)
 {
-	bool ok;
 	int err;
-	int modem_voltage;
-	int modem_temp;
 
-	err = modem_info_get_batt_voltage(&modem_voltage);
+	err = modem_info_get_batt_voltage(&sample->modem_voltage);
 	if (err) {
 		LOG_ERR("Modem voltage read failed, err: %d\n", err);
-		return GOLIOTH_ERR_FAIL;
+		return err;
 	}
-	LOG_INF("Modem voltage: %d mV", modem_voltage);
+	LOG_INF("Modem voltage: %d mV", sample->modem_voltage);
 
-	err = modem_info_get_temperature(&modem_temp);
+	err = modem_info_get_temperature(&sample->modem_temp);
 	if (err) {
 		LOG_ERR("Modem Temp read failed, err: %d\n", err);
-		return GOLIOTH_ERR_FAIL;
+		return err;
 	}
-	LOG_INF("Modem Temp: %d degC\n", modem_temp);
+	LOG_INF("Modem Temp: %d degC\n", sample->modem_temp);
+
+	return 0;
+}
+
+static void read_sample(struct sensor_sample *sample)
+{
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_begin(ENERGY_LEDGER_OP_SENSOR_READ);));
+
+	memset(sample, 0, sizeof(*sample));
+
+	if (date_time_now(&sample->timestamp_ms))
+	{
+		/* Network time not known yet, Golioth stamps it on arrival */
+		sample->timestamp_ms = 0;
+	}
+
+	sample->modem_valid = (read_modem_data(sample) == 0);
+	IF_ENABLED(CONFIG_SAMPLER, (sampler_summary_get(&sample->summary);));
+	IF_ENABLED(CONFIG_SUPERCAP_MODEL, (supercap_estimate_get(&sample->supercap);));
+	sample->tx_success = app_sensors_get_tx_success_count();
+	sample->tx_failure = app_sensors_get_tx_failure_count();
 
-	ok = zcbor_tstr_put_lit(zse, "modem") && zcbor_map_start_encode(zse, MODEM_MAP_ENTRIES);
+	get_battery_data(&sample->battery);
+
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_end(ENERGY_LEDGER_OP_SENSOR_READ);));
+}
+
+static enum golioth_status encode_modem_data(zcbor_state_t *zse,
+					     const struct sensor_sample *sample)
+{
+	bool ok;
+
+	ok = put_key(zse, SAMPLE_KEY_MODEM, "modem") &&
+	     zcbor_map_start_encode(zse, MODEM_MAP_ENTRIES);
 	if (!ok) {
 		LOG_ERR("ZCBOR unable to open modem map");
 		return GOLIOTH_ERR_QUEUE_FULL;
 	}
 
-	ok = zcbor_tstr_put_lit(zse, "vbat") &&
-		 zcbor_int32_put(zse, modem_voltage) &&
-		 zcbor_tstr_put_lit(zse, "temp") &&
-		 zcbor_int32_put(zse, modem_temp) &&
-		 zcbor_tstr_put_lit(zse, "success") &&
-		 zcbor_int32_put(zse, app_sensors_get_tx_success_count()) &&
-		 zcbor_tstr_put_lit(zse, "fail") &&
-		 zcbor_int32_put(zse, app_sensors_get_tx_failure_count());
+	ok = put_key(zse, MODEM_KEY_VBAT, "vbat") &&
+		 zcbor_int32_put(zse, sample->modem_voltage) &&
+		 put_key(zse, MODEM_KEY_TEMP, "temp") &&
+		 zcbor_int32_put(zse, sample->modem_temp) &&
+		 put_key(zse, MODEM_KEY_SUCCESS, "success") &&
+		 zcbor_uint32_put(zse, sample->tx_success) &&
+		 put_key(zse, MODEM_KEY_FAIL, "fail") &&
+		 zcbor_uint32_put(zse, sample->tx_failure);
 
 	if (!ok) {
 		LOG_ERR("ZCBOR failed to encode modem data");
@@ -105,41 +223,45 @@ static enum golioth_status read_modem_data(zcbor_state_t *zse)
 	return GOLIOTH_OK;
 }
 
-static enum golioth_status read_battery_data(zcbor_state_t *zse)
+/* The compact schema sends battery values as integers in the unit given by
+ * scale (e.g. 1000 for mV from V) and leaves out values the fuel gauge has no
+ * estimate for. The default schema sends the floats unchanged.
+ */
+static bool put_battery_value(zcbor_state_t *zse, uint32_t key, const char *name,
+			      float value, float scale)
+{
+#if defined(CONFIG_TELEMETRY_COMPACT_SCHEMA)
+	if (!isfinite(value) || fabsf(value * scale) > (float)INT32_MAX)
+	{
+		return true;
+	}
+
+	return zcbor_uint32_put(zse, key) && zcbor_int32_put(zse, (int32_t)lroundf(value * scale));
+#else
+	return zcbor_tstr_put_term(zse, name, KEY_MAX_LEN) &&
+	       zcbor_float64_put(zse, (double)value);
+#endif
+}
+
+static enum golioth_status encode_battery_data(zcbor_state_t *zse,
+					       const struct sensor_sample *sample)
 {
 	bool ok;
-	struct battery_data batt_data;
-	get_battery_data(&batt_data);
-
-	struct sensor_value voltage;
-	struct sensor_value current;
-	struct sensor_value soc;
-	struct sensor_value tte;
-	struct sensor_value ttf;
-
-	sensor_value_from_double(&voltage, batt_data.voltage);
-	sensor_value_from_double(&current, batt_data.current);
-	sensor_value_from_double(&soc, batt_data.soc);
-	sensor_value_from_double(&tte, batt_data.tte);
-	sensor_value_from_double(&ttf, batt_data.ttf);
-
-	ok = zcbor_tstr_put_lit(zse, "battery") && zcbor_map_start_encode(zse, BATTERY_MAP_ENTRIES);
+	const struct battery_data *batt_data = &sample->battery;
+
+	ok = put_key(zse, SAMPLE_KEY_BATTERY, "battery") &&
+	     zcbor_map_start_encode(zse, BATTERY_MAP_ENTRIES);
 	if (!ok)
 	{
 		LOG_ERR("ZCBOR unable to open battery map");
 		return GOLIOTH_ERR_QUEUE_FULL;
 	}
 
-	ok = zcbor_tstr_put_lit(zse, "V") &&
-		 zcbor_float64_put(zse, sensor_value_to_double(&voltage)) &&
-		 zcbor_tstr_put_lit(zse, "I") &&
-		 zcbor_float64_put(zse, sensor_value_to_double(&current)) &&
-		 zcbor_tstr_put_lit(zse, "SoC") &&
-		 zcbor_float64_put(zse, sensor_value_to_double(&soc)) &&
-		 zcbor_tstr_put_lit(zse, "tte") &&
-		 zcbor_float64_put(zse, sensor_value_to_double(&tte)) &&
-		 zcbor_tstr_put_lit(zse, "ttf") &&
-		 zcbor_float64_put(zse, sensor_value_to_double(&ttf));
+	ok = put_battery_value(zse, BATTERY_KEY_VOLTAGE, "V", batt_data->voltage, 1000.f) &&
+	     put_battery_value(zse, BATTERY_KEY_CURRENT, "I", batt_data->current, 1000.f) &&
+	     put_battery_value(zse, BATTERY_KEY_SOC, "SoC", batt_data->soc, 10.f) &&
+	     put_battery_value(zse, BATTERY_KEY_TTE, "tte", batt_data->tte, 1.f) &&
+	     put_battery_value(zse, BATTERY_KEY_TTF, "ttf", batt_data->ttf, 1.f);
 
 	if (!ok)
 	{
@@ -157,64 +279,615 @@ static enum golioth_status read_battery_data(zcbor_state_t *zse)
 	return GOLIOTH_OK;
 }
 
-/* This will be called by the main() loop */
-/* Do all of your work here! */
-void app_sensors_read_and_stream(void)
+#if defined(CONFIG_SAMPLER)
+/* min, max, mean and last of one field, scaled the same way as the
+ * corresponding battery value.
+ */
+static bool put_field_stats(zcbor_state_t *zse, uint32_t key, const char *name,
+			    const struct field_stats *stats, float scale)
 {
-	int err;
+	const float values[] = { stats->min, stats->max, stats->mean, stats->last };
 	bool ok;
-	enum golioth_status status;
-	char cbor_buf[256];
 
-	ZCBOR_STATE_E(zse, NUM_SENSOR_KEY_VALUE_PAIRS, cbor_buf, sizeof(cbor_buf), 1);
+#if defined(CONFIG_TELEMETRY_COMPACT_SCHEMA)
+	ok = zcbor_uint32_put(zse, key);
+#else
+	ok = zcbor_tstr_put_term(zse, name, KEY_MAX_LEN);
+#endif
+	ok = ok && zcbor_list_start_encode(zse, ARRAY_SIZE(values));
 
-	ok = zcbor_map_start_encode(zse, NUM_SENSOR_KEY_VALUE_PAIRS);
+	for (size_t i = 0; ok && i < ARRAY_SIZE(values); i++)
+	{
+#if defined(CONFIG_TELEMETRY_COMPACT_SCHEMA)
+		ok = zcbor_int32_put(zse, (int32_t)lroundf(values[i] * scale));
+#else
+		ok = zcbor_float32_put(zse, values[i]);
+#endif
+	}
+
+	return ok && zcbor_list_end_encode(zse, ARRAY_SIZE(values));
+}
+
+static enum golioth_status encode_stats(zcbor_state_t *zse, const struct sensor_sample *sample)
+{
+	const struct sample_summary *summary = &sample->summary;
+	bool ok;
+
+	ok = put_key(zse, SAMPLE_KEY_STATS, "stats") &&
+	     zcbor_map_start_encode(zse, STATS_MAP_ENTRIES);
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR unable to open stats map");
+		return GOLIOTH_ERR_QUEUE_FULL;
+	}
+
+	ok = put_key(zse, STATS_KEY_COUNT, "n") &&
+	     zcbor_uint32_put(zse, summary->count) &&
+	     put_field_stats(zse, STATS_KEY_VOLTAGE, "V", &summary->voltage, 1000.f) &&
+	     put_field_stats(zse, STATS_KEY_CURRENT, "I", &summary->current, 1000.f) &&
+	     put_field_stats(zse, STATS_KEY_SOC, "SoC", &summary->soc, 10.f) &&
+	     put_key(zse, STATS_KEY_DROPPED, "drop") &&
+	     zcbor_uint32_put(zse, summary->dropped);
+
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR failed to encode stats");
+		return GOLIOTH_ERR_QUEUE_FULL;
+	}
+
+	ok = zcbor_map_end_encode(zse, STATS_MAP_ENTRIES);
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR failed to close stats map");
+		return GOLIOTH_ERR_QUEUE_FULL;
+	}
+
+	return GOLIOTH_OK;
+}
+#endif /* CONFIG_SAMPLER */
+
+#if defined(CONFIG_SUPERCAP_MODEL)
+static enum golioth_status encode_supercap(zcbor_state_t *zse, const struct sensor_sample *sample)
+{
+	const struct supercap_estimate *estimate = &sample->supercap;
+	bool ok;
+
+	ok = put_key(zse, SAMPLE_KEY_SUPERCAP, "supercap") &&
+	     zcbor_map_start_encode(zse, SUPERCAP_MAP_ENTRIES);
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR unable to open supercap map");
+		return GOLIOTH_ERR_QUEUE_FULL;
+	}
+
+	/* Energies in J, or mJ with the compact schema */
+	ok = put_battery_value(zse, SUPERCAP_KEY_USABLE, "E", estimate->usable_j, 1000.f) &&
+	     put_key(zse, SUPERCAP_KEY_CYCLES_LEFT, "n") &&
+	     zcbor_uint32_put(zse, estimate->cycles_left) &&
+	     put_battery_value(zse, SUPERCAP_KEY_CYCLE_COST, "cyc", estimate->cycle_j, 1000.f);
+
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR failed to encode supercap data");
+		return GOLIOTH_ERR_QUEUE_FULL;
+	}
+
+	ok = zcbor_map_end_encode(zse, SUPERCAP_MAP_ENTRIES);
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR failed to close supercap map");
+		return GOLIOTH_ERR_QUEUE_FULL;
+	}
+
+	return GOLIOTH_OK;
+}
+#endif /* CONFIG_SUPERCAP_MODEL */
+
+static enum golioth_status encode_sample(zcbor_state_t *zse, const struct sensor_sample *sample)
+{
+	enum golioth_status status;
+	bool ok;
 
+	ok = zcbor_map_start_encode(zse, NUM_SENSOR_KEY_VALUE_PAIRS);
 	if (!ok)
 	{
 		LOG_ERR("ZCBOR failed to open map");
-		return;
+		return GOLIOTH_ERR_QUEUE_FULL;
 	}
 
-	status = read_modem_data(zse);
-	if (status == GOLIOTH_ERR_QUEUE_FULL)
+#if defined(CONFIG_TELEMETRY_COMPACT_SCHEMA)
+	ok = zcbor_uint32_put(zse, SAMPLE_KEY_SCHEMA) &&
+	     zcbor_uint32_put(zse, COMPACT_SCHEMA_VERSION);
+	if (!ok)
 	{
-		return;
+		LOG_ERR("ZCBOR failed to encode schema version");
+		return GOLIOTH_ERR_QUEUE_FULL;
 	}
+#endif
 
-	status = read_battery_data(zse);
-	if (status == GOLIOTH_ERR_QUEUE_FULL)
+	if (sample->timestamp_ms)
 	{
-		return;
+		ok = put_key(zse, SAMPLE_KEY_TS, "ts") &&
+		     zcbor_int64_put(zse, sample->timestamp_ms);
+		if (!ok)
+		{
+			LOG_ERR("ZCBOR failed to encode timestamp");
+			return GOLIOTH_ERR_QUEUE_FULL;
+		}
+	}
+
+	if (sample->modem_valid)
+	{
+		status = encode_modem_data(zse, sample);
+		if (status != GOLIOTH_OK)
+		{
+			return status;
+		}
+	}
+
+	status = encode_battery_data(zse, sample);
+	if (status != GOLIOTH_OK)
+	{
+		return status;
+	}
+
+#if defined(CONFIG_SAMPLER)
+	if (sample->summary.count > 0)
+	{
+		status = encode_stats(zse, sample);
+		if (status != GOLIOTH_OK)
+		{
+			return status;
+		}
+	}
+#endif
+
+#if defined(CONFIG_SUPERCAP_MODEL)
+	status = encode_supercap(zse, sample);
+	if (status != GOLIOTH_OK)
+	{
+		return status;
 	}
+#endif
 
 	ok = zcbor_map_end_encode(zse, NUM_SENSOR_KEY_VALUE_PAIRS);
 	if (!ok)
 	{
 		LOG_ERR("ZCBOR failed to close map");
+		return GOLIOTH_ERR_QUEUE_FULL;
+	}
+
+	return GOLIOTH_OK;
+}
+
+static void store_sample(const struct sensor_sample *sample)
+{
+#if defined(CONFIG_SAMPLE_STORE)
+	int err = sample_store_push(sample);
+
+	if (err)
+	{
+		LOG_ERR("Failed to queue sample: %d", err);
 	}
+#else
+	LOG_DBG("No sample store, dropping sample");
+#endif
+}
 
-	size_t cbor_size = zse->payload - (const uint8_t *)cbor_buf;
+/* Admission of count uplinks, always granted without admission control */
+static enum admission_verdict tx_admission(uint32_t count)
+{
+#if defined(CONFIG_ADMISSION_CONTROL)
+	return admission_check(ENERGY_LEDGER_OP_TX, count);
+#else
+	return ADMISSION_ADMIT;
+#endif
+}
 
-	/* Only stream sensor data if connected */
-	if (golioth_client_is_connected(client))
+/* Encode up to *count samples read from source into one CBOR array and
+ * upload it to the batch endpoint, waiting for Golioth to acknowledge it.
+ * Encoding stops at the first sample the source cannot provide; *count is
+ * updated to the number of samples in the array.
+ */
+static __maybe_unused int stream_batch(sample_source_fn source, size_t *count)
+{
+	static uint8_t cbor_buf[BATCH_MAX_SAMPLES * SAMPLE_CBOR_MAX_SIZE];
+	struct sensor_sample sample;
+	enum golioth_status status;
+	size_t batch = MIN(*count, BATCH_MAX_SAMPLES);
+	bool ok;
+
+	ZCBOR_STATE_E(zse, 3, cbor_buf, sizeof(cbor_buf), 1);
+
+	ok = zcbor_list_start_encode(zse, batch);
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR failed to open batch array");
+		return -ENOMEM;
+	}
+
+	for (size_t i = 0; i < batch; i++)
 	{
-		/* Send to LightDB Stream on "sensor" endpoint */
-		err = golioth_stream_set_async(client, "sensor", GOLIOTH_CONTENT_TYPE_CBOR, cbor_buf,
-									   cbor_size, async_error_handler, NULL);
+		if (source(i, &sample))
+		{
+			batch = i;
+			break;
+		}
+
+		status = encode_sample(zse, &sample);
+		if (status != GOLIOTH_OK)
+		{
+			return -ENOMEM;
+		}
+	}
+
+	*count = batch;
+	if (batch == 0)
+	{
+		return -ENODATA;
+	}
+
+	ok = zcbor_list_end_encode(zse, batch);
+	if (!ok)
+	{
+		LOG_ERR("ZCBOR failed to close batch array");
+		return -ENOMEM;
+	}
+
+	size_t cbor_size = zse->payload - cbor_buf;
+
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_begin(ENERGY_LEDGER_OP_TX);));
+	status = golioth_stream_set_sync(client, SENSOR_BATCH_ENDP, GOLIOTH_CONTENT_TYPE_CBOR,
+					 cbor_buf, cbor_size,
+					 CONFIG_SENSOR_BATCH_TX_TIMEOUT_SECONDS);
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_end(ENERGY_LEDGER_OP_TX);));
+	if (status != GOLIOTH_OK)
+	{
+		retained_inc(RETAINED_TX_FAILURE);
+		LOG_ERR("Failed to send sample batch to Golioth: %d", status);
+		return -EIO;
+	}
+
+	retained_inc(RETAINED_TX_SUCCESS);
+	LOG_INF("Sent batch of %u samples (%u bytes)", batch, cbor_size);
+
+	return 0;
+}
+
+#if defined(CONFIG_SAMPLE_STORE)
+/* Upload queued samples oldest-first. Samples are only removed from the
+ * store once Golioth has acknowledged the batch they were sent in.
+ */
+static int stream_stored_samples(void)
+{
+	size_t pending;
+	size_t batch;
+	int err;
+
+	while ((pending = sample_store_count()) > 0)
+	{
+		/* Keep enough for the uplink that follows the drain */
+		if (tx_admission(2) != ADMISSION_ADMIT)
+		{
+			LOG_INF("Energy too low to drain the queue, %u samples left", pending);
+			return 0;
+		}
+
+		batch = MIN(pending, CONFIG_SAMPLE_STORE_DRAIN_BATCH);
+
+		err = stream_batch(sample_store_peek, &batch);
+		if (err == -ENODATA)
+		{
+			LOG_WRN("Dropping unreadable queued sample");
+			sample_store_pop(1);
+			continue;
+		}
 		if (err)
-		{   
-			tx_failure_counter++;
-			LOG_ERR("Failed to send sensor data to Golioth: %d", err);
+		{
+			return err;
+		}
+
+		sample_store_pop(batch);
+		LOG_INF("%u queued samples remaining", sample_store_count());
+	}
+
+	return 0;
+}
+#else
+static inline int stream_stored_samples(void)
+{
+	return 0;
+}
+#endif /* CONFIG_SAMPLE_STORE */
+
+#if defined(CONFIG_SEND_ON_CHANGE)
+static struct sensor_sample last_reported;
+static int64_t last_reported_time;
+static bool reported_once;
+
+static bool moved(float now, float then, float scale, int32_t deadband)
+{
+	return (deadband > 0) && (fabsf(now - then) * scale >= (float)deadband);
+}
+
+/* Decide whether a sample is worth waking the radio for, and remember it as
+ * the new reference when it is.
+ */
+static bool sample_should_report(const struct sensor_sample *sample)
+{
+	const struct report_deadbands *db = get_report_deadbands();
+	const struct battery_data *now = &sample->battery;
+	const struct battery_data *then = &last_reported.battery;
+	int64_t elapsed_ms = k_uptime_get() - last_reported_time;
+	bool report;
+
+	if (!reported_once || db->heartbeat_s == 0 ||
+	    elapsed_ms >= (int64_t)db->heartbeat_s * MSEC_PER_SEC)
+	{
+		report = true;
+	}
+	else
+	{
+		report = moved(now->voltage, then->voltage, 1000.f, db->vbat_mv) ||
+			 moved(now->current, then->current, 1000.f, db->current_ma) ||
+			 moved(now->soc, then->soc, 1.f, db->soc_pct);
+
+		if (sample->modem_valid && last_reported.modem_valid)
+		{
+			report = report ||
+				 moved(sample->modem_voltage, last_reported.modem_voltage, 1.f,
+				       db->vbat_mv) ||
+				 moved(sample->modem_temp, last_reported.modem_temp, 1.f,
+				       db->temp_c);
 		}
-		else 
+	}
+
+	if (report)
+	{
+		last_reported = *sample;
+		last_reported_time = k_uptime_get();
+		reported_once = true;
+	}
+
+	return report;
+}
+#else
+static inline bool sample_should_report(const struct sensor_sample *sample)
+{
+	return true;
+}
+#endif /* CONFIG_SEND_ON_CHANGE */
+
+#if defined(CONFIG_SAMPLE_BATCH)
+static struct sensor_sample sample_batch[CONFIG_SAMPLE_BATCH_MAX_SIZE];
+static size_t sample_batch_count;
+static int64_t sample_batch_started;
+
+static int sample_batch_peek(size_t index, struct sensor_sample *sample)
+{
+	if (index >= sample_batch_count)
+	{
+		return -ENOENT;
+	}
+
+	*sample = sample_batch[index];
+
+	return 0;
+}
+
+static void sample_batch_add(const struct sensor_sample *sample)
+{
+	if (sample_batch_count == 0)
+	{
+		sample_batch_started = k_uptime_get();
+	}
+
+	sample_batch[sample_batch_count++] = *sample;
+}
+
+/* A batch is due once it is full or its oldest sample reached the max age,
+ * unless it can wait for a predicted high-harvest window.
+ */
+static bool sample_batch_due(void)
+{
+	int32_t batch_size = MIN(get_batch_size(), CONFIG_SAMPLE_BATCH_MAX_SIZE);
+	int32_t max_age_s = get_batch_max_age_s();
+
+	if (sample_batch_count == 0)
+	{
+		return false;
+	}
+
+	if (sample_batch_count < batch_size &&
+	    (max_age_s <= 0 ||
+	     (k_uptime_get() - sample_batch_started) < (int64_t)max_age_s * MSEC_PER_SEC))
+	{
+		return false;
+	}
+
+#if defined(CONFIG_ENERGY_SCHEDULER)
+	/* While there is room left, hold the uplink for the harvest window */
+	if (sample_batch_count < CONFIG_SAMPLE_BATCH_MAX_SIZE && scheduler_defer_s() > 0)
+	{
+		LOG_DBG("Holding batch of %u for the harvest window", sample_batch_count);
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+static void sample_batch_flush(void)
+{
+	enum admission_verdict verdict = tx_admission(2);
+	size_t sent = 0;
+
+	/* A degraded uplink sends the batch and leaves the queue for later */
+	if (client && golioth_client_is_connected(client) && verdict != ADMISSION_DEFER &&
+	    (verdict == ADMISSION_DEGRADE || stream_stored_samples() == 0))
+	{
+		sent = sample_batch_count;
+		if (stream_batch(sample_batch_peek, &sent))
 		{
-			tx_success_counter++;
+			sent = 0;
 		}
 	}
+
+	/* Whatever could not be sent is kept for the next connection */
+	for (size_t i = sent; i < sample_batch_count; i++)
+	{
+		store_sample(&sample_batch[i]);
+	}
+
+	sample_batch_count = 0;
+}
+#endif /* CONFIG_SAMPLE_BATCH */
+
+#if defined(CONFIG_SAMPLE_BATCH)
+/* Set when the buffered batch is due for the next radio window */
+static bool batch_flush_pending;
+#endif
+
+/* Sample waiting for the next radio window */
+static struct sensor_sample pending_sample;
+static bool sample_pending;
+
+/* Called by the sensor job, returns true when there is something to send */
+bool app_sensors_read(void)
+{
+	struct sensor_sample sample;
+
+	read_sample(&sample);
+
+	if (sample_should_report(&sample))
+	{
+		/* The summary now belongs to this sample, start a new window */
+		IF_ENABLED(CONFIG_SAMPLER, (sampler_summary_reset();));
+	}
 	else
 	{
-		LOG_DBG("No connection available, skipping sending data to Golioth");
+		LOG_DBG("Sample within deadbands, not reporting");
+#if defined(CONFIG_SAMPLE_BATCH)
+		/* A partial batch still has to go out once it is old enough */
+		if (sample_batch_due())
+		{
+			batch_flush_pending = true;
+			return true;
+		}
+#endif
+		return false;
+	}
+
+#if defined(CONFIG_SAMPLE_BATCH)
+	if (get_batch_size() > 1 || sample_batch_count > 0)
+	{
+		sample_batch_add(&sample);
+		if (sample_batch_due())
+		{
+			batch_flush_pending = true;
+			return true;
+		}
+
+		LOG_DBG("Buffered sample %u of %d", sample_batch_count, get_batch_size());
+		return false;
+	}
+#endif
+
+	if (sample_pending)
+	{
+		/* The last window did not run, keep the older sample */
+		store_sample(&pending_sample);
+	}
+
+	pending_sample = sample;
+	sample_pending = true;
+
+	return true;
+}
+
+static void stream_sample(const struct sensor_sample *sample)
+{
+	int err;
+	enum admission_verdict verdict;
+	enum golioth_status status;
+	uint8_t cbor_buf[SAMPLE_CBOR_MAX_SIZE];
+
+	/* Only stream sensor data if connected */
+	if (!client || !golioth_client_is_connected(client))
+	{
+		LOG_DBG("No connection available, queueing sample");
+		store_sample(sample);
+		return;
+	}
+
+	/* The sample itself and at least one queued batch */
+	verdict = tx_admission(2);
+	if (verdict == ADMISSION_DEFER)
+	{
+		LOG_INF("Uplink deferred, not enough energy");
+		store_sample(sample);
+		return;
+	}
+
+	/* Send anything queued while offline first, keeping samples in order.
+	 * A degraded uplink only sends this sample, with its own timestamp.
+	 */
+	if (verdict == ADMISSION_ADMIT && stream_stored_samples())
+	{
+		store_sample(sample);
+		return;
+	}
+
+	ZCBOR_STATE_E(zse, 2, cbor_buf, sizeof(cbor_buf), 1);
+
+	status = encode_sample(zse, sample);
+	if (status != GOLIOTH_OK)
+	{
+		LOG_ERR("Failed to encode sample, queueing it: %d", status);
+		store_sample(sample);
+		return;
+	}
+
+	size_t cbor_size = zse->payload - cbor_buf;
+
+	LOG_INF("Sensor payload: %u bytes", cbor_size);
+
+	/* Send to LightDB Stream on "sensor" endpoint. The TX measurement ends
+	 * in sensor_stream_handler() once Golioth has answered.
+	 */
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_begin(ENERGY_LEDGER_OP_TX);));
+	conn_mgr_request_sent();
+	err = golioth_stream_set_async(client, SENSOR_ENDP, GOLIOTH_CONTENT_TYPE_CBOR, cbor_buf,
+				       cbor_size, sensor_stream_handler, NULL);
+	if (err)
+	{
+		conn_mgr_request_done();
+		IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_end(ENERGY_LEDGER_OP_TX);));
+		retained_inc(RETAINED_TX_FAILURE);
+		LOG_ERR("Failed to send sensor data to Golioth: %d", err);
+		store_sample(sample);
+	}
+	else
+	{
+		retained_inc(RETAINED_TX_SUCCESS);
+	}
+}
+
+/* Called in the radio window, sends what app_sensors_read() left */
+void app_sensors_stream(void)
+{
+#if defined(CONFIG_SAMPLE_BATCH)
+	if (batch_flush_pending)
+	{
+		batch_flush_pending = false;
+		sample_batch_flush();
+	}
+#endif
+
+	if (sample_pending)
+	{
+		sample_pending = false;
+		stream_sample(&pending_sample);
 	}
 }
 
@@ -223,16 +896,63 @@ void app_sensors_set_client(struct golioth_client *sensors_client)
 	client = sensors_client;
 }
 
+/* Called before the device powers down: samples buffered in RAM go to the
+ * store and the reporting state is handed over to the caller.
+ */
+void app_sensors_suspend(struct app_sensors_resume *state)
+{
+	memset(state, 0, sizeof(*state));
+
+	if (sample_pending)
+	{
+		sample_pending = false;
+		store_sample(&pending_sample);
+	}
+
+#if defined(CONFIG_SAMPLE_BATCH)
+	batch_flush_pending = false;
+	for (size_t i = 0; i < sample_batch_count; i++)
+	{
+		store_sample(&sample_batch[i]);
+	}
+	sample_batch_count = 0;
+#endif
+
+#if defined(CONFIG_SEND_ON_CHANGE)
+	state->reported_once = reported_once;
+	state->reported_ago_ms = k_uptime_get() - last_reported_time;
+	state->last_reported = last_reported;
+#endif
+}
+
+void app_sensors_resume(const struct app_sensors_resume *state, int64_t slept_ms)
+{
+#if defined(CONFIG_SEND_ON_CHANGE)
+	/* The heartbeat keeps running while the device is powered down */
+	reported_once = state->reported_once;
+	last_reported_time = k_uptime_get() - state->reported_ago_ms - slept_ms;
+	last_reported = state->last_reported;
+#endif
+}
+
 #define DEVICE_DATA_ENDP "device/state"
 
 int report_startup(void)
 {
 	int err;
-	char json_buf[128];
+	char json_buf[256];
+	char boot_ms[160];
 	uint32_t reset_reason;
 	
+	/* The report is the first uplink after a cold boot */
+	boot_timing_mark(BOOT_PHASE_FIRST_UPLINK);
+	if (boot_timing_json(boot_ms, sizeof(boot_ms))) {
+		strcpy(boot_ms, "{}");
+	}
+
 	reset_reason = nrfx_reset_reason_get();
-	snprintk(json_buf, sizeof(json_buf), JSON_FMT, reset_reason);
+	snprintk(json_buf, sizeof(json_buf), JSON_FMT, reset_reason,
+		 retained_get_u32(RETAINED_BOOT_COUNT), boot_ms);
 
 	LOG_INF("App: Reset reason: 0x%x", reset_reason);
 	nrfx_reset_reason_clear(reset_reason);
@@ -242,9 +962,11 @@ int report_startup(void)
 		return -EINVAL;
 	}
 
+	conn_mgr_request_sent();
 	err = golioth_stream_set_async(client, DEVICE_DATA_ENDP, GOLIOTH_CONTENT_TYPE_JSON, json_buf,
 				       strlen(json_buf), async_error_handler, NULL);
 	if (err) {
+		conn_mgr_request_done();
 		LOG_ERR("Failed to send device info to Golioth: %d", err);
 		return err;
 	} else {
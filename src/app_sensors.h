@@ -14,17 +14,66 @@
  *
  * For this demonstration, a `counter` value is periodically logged and pushed
  * to the Golioth time-series database. This simulated sensor reading occurs
- * when the loop in `main.c` calls `app_sensors_read_and_stream()`. The
- * frequency of this loop is determined by values received from the Golioth
- * Settings Service (see app_settings.h).
+ * when the sensor job in `main.c` calls `app_sensors_read()`; the sample is
+ * sent by `app_sensors_stream()` in the next radio window (see
+ * radio_window.h). The frequency of this loop is determined by values
+ * received from the Golioth Settings Service (see app_settings.h).
+ *
+ * With `CONFIG_TELEMETRY_COMPACT_SCHEMA` samples use integer map keys and
+ * scaled integer values instead of text keys and floats:
+ *
+ *   0: schema version (1)
+ *   1: Unix time in ms
+ *   2: modem   { 0: vbat mV, 1: temp degC, 2: tx success, 3: tx fail }
+ *   3: battery { 0: mV, 1: mA, 2: SoC in 0.1 %, 3: tte s, 4: ttf s }
+ *   4: stats   { 0: count, 1: mV, 2: mA, 3: SoC in 0.1 %, 4: dropped }
+ *   5: supercap { 0: usable mJ, 1: cycles left, 2: cycle cost mJ }
+ *
+ * Each stats field is a [min, max, mean, last] array over the samples taken
+ * by the background sampler since the previous report (see sampler.h);
+ * dropped counts the readings lost because the sample ring was full.
+ *
+ * Battery values without an estimate (NaN) are left out of the map.
  *
  * https://docs.golioth.io/firmware/zephyr-device-sdk/light-db-stream/
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <golioth/client.h>
+#include "fuel_gauge.h"
+#include "sampler.h"
+#include "supercap.h"
+
+/** One sensor reading, as streamed or queued for a later upload */
+struct sensor_sample {
+	int64_t timestamp_ms;	/* Unix time, 0 if not known yet */
+	int32_t modem_voltage;
+	int32_t modem_temp;
+	uint32_t tx_success;
+	uint32_t tx_failure;
+	bool modem_valid;
+	struct battery_data battery;
+#if defined(CONFIG_SAMPLER)
+	struct sample_summary summary;
+#endif
+#if defined(CONFIG_SUPERCAP_MODEL)
+	struct supercap_estimate supercap;
+#endif
+};
+
+/** Reporting state carried across a hibernate, see hibernate.h */
+struct app_sensors_resume {
+	bool reported_once;
+	int64_t reported_ago_ms;	/* Age of last_reported at suspend */
+	struct sensor_sample last_reported;
+};
 
 void app_sensors_set_client(struct golioth_client *sensors_client);
-void app_sensors_read_and_stream(void);
+bool app_sensors_read(void);
+void app_sensors_stream(void);
 int report_startup(void);
+void app_sensors_suspend(struct app_sensors_resume *state);
+void app_sensors_resume(const struct app_sensors_resume *state, int64_t slept_ms);
 
 #endif /* __APP_SENSORS_H__ */
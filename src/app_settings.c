@@ -11,24 +11,109 @@ LOG_MODULE_REGISTER(app_settings, LOG_LEVEL_DBG);
 #include <golioth/settings.h>
 #include "main.h"
 #include "app_settings.h"
+#include "retained.h"
+#include "jobs.h"
+#include "psm.h"
 
-static int32_t _loop_delay_s = CONFIG_SENSOR_SAMPLE_INTERVAL_SECONDS;
 #define LOOP_DELAY_S_MAX 43200
 #define LOOP_DELAY_S_MIN 1
 
+#if defined(CONFIG_SAMPLE_BATCH)
+static int32_t _batch_size = CONFIG_SAMPLE_BATCH_DEFAULT_SIZE;
+static int32_t _batch_max_age_s = CONFIG_SAMPLE_BATCH_DEFAULT_MAX_AGE_SECONDS;
+#define BATCH_MAX_AGE_S_MAX LOOP_DELAY_S_MAX
+#endif
+
+#if defined(CONFIG_SEND_ON_CHANGE)
+static struct report_deadbands _deadbands = {
+	.vbat_mv = CONFIG_SEND_ON_CHANGE_VBAT_MV,
+	.temp_c = CONFIG_SEND_ON_CHANGE_TEMP_C,
+	.soc_pct = CONFIG_SEND_ON_CHANGE_SOC_PCT,
+	.current_ma = CONFIG_SEND_ON_CHANGE_CURRENT_MA,
+	.heartbeat_s = CONFIG_SEND_ON_CHANGE_HEARTBEAT_SECONDS,
+};
+
+struct deadband_setting {
+	const char *key;
+	int32_t *value;
+	int32_t max;
+};
+
+static const struct deadband_setting deadband_settings[] = {
+	{ "DEADBAND_VBAT_MV", &_deadbands.vbat_mv, 1000 },
+	{ "DEADBAND_TEMP_C", &_deadbands.temp_c, 100 },
+	{ "DEADBAND_SOC_PCT", &_deadbands.soc_pct, 100 },
+	{ "DEADBAND_CURRENT_MA", &_deadbands.current_ma, 1000 },
+	{ "HEARTBEAT_S", &_deadbands.heartbeat_s, LOOP_DELAY_S_MAX * 2 },
+};
+#endif
+
 int32_t get_loop_delay_s(void)
 {
-	return _loop_delay_s;
+	return retained_get_i32(RETAINED_LOOP_DELAY_S);
+}
+
+#if defined(CONFIG_SAMPLE_BATCH)
+int32_t get_batch_size(void)
+{
+	return _batch_size;
+}
+
+int32_t get_batch_max_age_s(void)
+{
+	return _batch_max_age_s;
 }
+#endif
+
+#if defined(CONFIG_SEND_ON_CHANGE)
+const struct report_deadbands *get_report_deadbands(void)
+{
+	return &_deadbands;
+}
+#endif
 
 static enum golioth_settings_status on_loop_delay_setting(int32_t new_value, void *arg)
 {
-	_loop_delay_s = new_value;
+	/* Every session delivers all settings again, only a change matters */
+	if (new_value == retained_get_i32(RETAINED_LOOP_DELAY_S)) {
+		return GOLIOTH_SETTINGS_SUCCESS;
+	}
+
+	retained_set_i32(RETAINED_LOOP_DELAY_S, new_value);
 	LOG_INF("Set loop delay to %i seconds", new_value);
-	wake_system_thread();
+	IF_ENABLED(CONFIG_PSM_COORDINATOR, (psm_loop_delay_update(new_value);));
+	/* Start the next cycle now so the new interval applies right away */
+	jobs_schedule(JOB_SENSORS, 0);
+	return GOLIOTH_SETTINGS_SUCCESS;
+}
+
+#if defined(CONFIG_SAMPLE_BATCH)
+static enum golioth_settings_status on_batch_size_setting(int32_t new_value, void *arg)
+{
+	_batch_size = new_value;
+	LOG_INF("Set batch size to %i samples", new_value);
 	return GOLIOTH_SETTINGS_SUCCESS;
 }
 
+static enum golioth_settings_status on_batch_max_age_setting(int32_t new_value, void *arg)
+{
+	_batch_max_age_s = new_value;
+	LOG_INF("Set batch max age to %i seconds", new_value);
+	return GOLIOTH_SETTINGS_SUCCESS;
+}
+#endif
+
+#if defined(CONFIG_SEND_ON_CHANGE)
+static enum golioth_settings_status on_deadband_setting(int32_t new_value, void *arg)
+{
+	const struct deadband_setting *setting = arg;
+
+	*setting->value = new_value;
+	LOG_INF("Set %s to %i", setting->key, new_value);
+	return GOLIOTH_SETTINGS_SUCCESS;
+}
+#endif
+
 int app_settings_register(struct golioth_client *client)
 {
 	struct golioth_settings *settings = golioth_settings_init(client);
@@ -44,5 +129,41 @@ int app_settings_register(struct golioth_client *client)
 		LOG_ERR("Failed to register settings callback: %d", err);
 	}
 
+#if defined(CONFIG_SAMPLE_BATCH)
+	err = golioth_settings_register_int_with_range(settings,
+						       "BATCH_SIZE",
+						       1,
+						       CONFIG_SAMPLE_BATCH_MAX_SIZE,
+						       on_batch_size_setting,
+						       NULL);
+	if (err) {
+		LOG_ERR("Failed to register settings callback: %d", err);
+	}
+
+	err = golioth_settings_register_int_with_range(settings,
+						       "BATCH_MAX_AGE_S",
+						       0,
+						       BATCH_MAX_AGE_S_MAX,
+						       on_batch_max_age_setting,
+						       NULL);
+	if (err) {
+		LOG_ERR("Failed to register settings callback: %d", err);
+	}
+#endif
+
+#if defined(CONFIG_SEND_ON_CHANGE)
+	ARRAY_FOR_EACH_PTR(deadband_settings, setting) {
+		err = golioth_settings_register_int_with_range(settings,
+							       setting->key,
+							       0,
+							       setting->max,
+							       on_deadband_setting,
+							       (void *)setting);
+		if (err) {
+			LOG_ERR("Failed to register settings callback: %d", err);
+		}
+	}
+#endif
+
 	return err;
 }
@@ -12,6 +12,14 @@
  * Settings Service and uses this value to determine the delay between sensor
  * reads (the period of sleep in the loop of `main.c`.
  *
+ * With `CONFIG_SAMPLE_BATCH`, `BATCH_SIZE` sets how many samples are buffered
+ * before they are uplinked together, and `BATCH_MAX_AGE_S` (0 for no limit)
+ * flushes a partial batch once its oldest sample reaches that age.
+ *
+ * With `CONFIG_SEND_ON_CHANGE`, the `DEADBAND_*` and `HEARTBEAT_S` keys set
+ * how far a reading has to move before it is uplinked (see
+ * `struct report_deadbands`).
+ *
  * https://docs.golioth.io/firmware/zephyr-device-sdk/device-settings-service
  */
 
@@ -22,6 +30,22 @@
 #include <golioth/client.h>
 
 int32_t get_loop_delay_s(void);
+int32_t get_batch_size(void);
+int32_t get_batch_max_age_s(void);
+
+/** Send-on-change thresholds. A sample is reported when a field moved at least
+ * its deadband since the last report (a deadband of 0 ignores that field), or
+ * once `heartbeat_s` has passed. A heartbeat of 0 reports every sample.
+ */
+struct report_deadbands {
+	int32_t vbat_mv;
+	int32_t temp_c;
+	int32_t soc_pct;
+	int32_t current_ma;
+	int32_t heartbeat_s;
+};
+
+const struct report_deadbands *get_report_deadbands(void);
 int app_settings_register(struct golioth_client *client);
 
 #endif /* __APP_SETTINGS_H__ */
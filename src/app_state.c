@@ -15,12 +15,12 @@ LOG_MODULE_REGISTER(app_state, LOG_LEVEL_DBG);
 
 #include "app_state.h"
 #include "app_sensors.h"
+#include "conn_mgr.h"
+#include "radio_window.h"
+#include "retained.h"
 
 #define DEVICE_STATE_FMT "{\"example_int0\":%d,\"example_int1\":%d}"
 
-uint32_t _example_int0;
-uint32_t _example_int1 = 1;
-
 static struct golioth_client *client;
 
 static void async_handler(struct golioth_client *client,
@@ -29,6 +29,8 @@ static void async_handler(struct golioth_client *client,
 			  const char *path,
 			  void *arg)
 {
+	conn_mgr_request_done();
+
 	if (status != GOLIOTH_OK) {
 		LOG_WRN("Failed to set state: %d", status);
 		return;
@@ -46,6 +48,7 @@ int app_state_reset_desired(void)
 	snprintk(sbuf, sizeof(sbuf), DEVICE_STATE_FMT, -1, -1);
 
 	int err;
+	conn_mgr_request_sent();
 	err = golioth_lightdb_set_async(client,
 					APP_STATE_DESIRED_ENDP,
 					GOLIOTH_CONTENT_TYPE_JSON,
@@ -54,6 +57,7 @@ int app_state_reset_desired(void)
 					async_handler,
 					NULL);
 	if (err) {
+		conn_mgr_request_done();
 		LOG_ERR("Unable to write to LightDB State: %d", err);
 	}
 	return err;
@@ -64,10 +68,13 @@ int app_state_update_actual(void)
 
 	char sbuf[sizeof(DEVICE_STATE_FMT) + 10]; /* space for uint16 values */
 
-	snprintk(sbuf, sizeof(sbuf), DEVICE_STATE_FMT, _example_int0, _example_int1);
+	snprintk(sbuf, sizeof(sbuf), DEVICE_STATE_FMT,
+		 retained_get_u32(RETAINED_EXAMPLE_INT0),
+		 retained_get_u32(RETAINED_EXAMPLE_INT1));
 
 	int err;
 
+	conn_mgr_request_sent();
 	err = golioth_lightdb_set_async(client,
 					APP_STATE_ACTUAL_ENDP,
 					GOLIOTH_CONTENT_TYPE_JSON,
@@ -77,6 +84,7 @@ int app_state_update_actual(void)
 					NULL);
 
 	if (err) {
+		conn_mgr_request_done();
 		LOG_ERR("Unable to write to LightDB State: %d", err);
 	}
 	return err;
@@ -116,8 +124,10 @@ static void app_state_desired_handler(struct golioth_client *client, enum goliot
 		if ((parsed_state.example_int0 >= 0) && (parsed_state.example_int0 < 65536)) {
 			LOG_DBG("Validated desired example_int0 value: %d",
 				parsed_state.example_int0);
-			if (_example_int0 != parsed_state.example_int0) {
-				_example_int0 = parsed_state.example_int0;
+			if (retained_get_u32(RETAINED_EXAMPLE_INT0) !=
+			    parsed_state.example_int0) {
+				retained_set_u32(RETAINED_EXAMPLE_INT0,
+						 parsed_state.example_int0);
 				++state_change_count;
 			}
 			++desired_processed_count;
@@ -134,8 +144,10 @@ static void app_state_desired_handler(struct golioth_client *client, enum goliot
 		if ((parsed_state.example_int1 >= 0) && (parsed_state.example_int1 < 65536)) {
 			LOG_DBG("Validated desired example_int1 value: %d",
 				parsed_state.example_int1);
-			if (_example_int1 != parsed_state.example_int1) {
-				_example_int1 = parsed_state.example_int1;
+			if (retained_get_u32(RETAINED_EXAMPLE_INT1) !=
+			    parsed_state.example_int1) {
+				retained_set_u32(RETAINED_EXAMPLE_INT1,
+						 parsed_state.example_int1);
 				++state_change_count;
 			}
 			++desired_processed_count;
@@ -149,8 +161,8 @@ static void app_state_desired_handler(struct golioth_client *client, enum goliot
 	}
 
 	if (state_change_count) {
-		/* The state was changed, so update the state on the Golioth servers */
-		err = app_state_update_actual();
+		/* The state was changed, report it with the next uplink */
+		radio_window_request(RADIO_INTENT_STATE_SYNC);
 	}
 	if (desired_processed_count) {
 		/* We processed some desired changes to return these to -1 on the server
@@ -164,12 +176,22 @@ static void app_state_desired_handler(struct golioth_client *client, enum goliot
 	}
 }
 
+static void app_state_sync(bool online)
+{
+	/* Keep the change for the next window until it has been sent */
+	if (!online || app_state_update_actual()) {
+		radio_window_request(RADIO_INTENT_STATE_SYNC);
+	}
+}
+
 int app_state_observe(struct golioth_client *state_client)
 {
 	int err;
 
 	client = state_client;
 
+	radio_window_register(RADIO_INTENT_STATE_SYNC, app_state_sync);
+
 	err = golioth_lightdb_observe_async(client,
 					    APP_STATE_DESIRED_ENDP,
 					    GOLIOTH_CONTENT_TYPE_JSON,
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(boot_timing, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include "boot_timing.h"
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+	[BOOT_PHASE_MAIN] = "main",
+	[BOOT_PHASE_POWER_READY] = "power",
+	[BOOT_PHASE_LTE_START] = "lte_start",
+	[BOOT_PHASE_INIT_DONE] = "init",
+	[BOOT_PHASE_LTE_REGISTERED] = "lte",
+	[BOOT_PHASE_CONNECTED] = "cloud",
+	[BOOT_PHASE_FIRST_UPLINK] = "uplink",
+};
+
+static ATOMIC_DEFINE(marked, BOOT_PHASE_COUNT);
+static uint32_t stamps[BOOT_PHASE_COUNT];
+
+void boot_timing_mark(enum boot_phase phase)
+{
+	uint32_t now = k_uptime_get_32();
+
+	if (atomic_test_and_set_bit(marked, phase)) {
+		return;
+	}
+
+	stamps[phase] = now;
+
+	LOG_DBG("Boot phase %s at %u ms", phase_names[phase], now);
+
+	if (phase == BOOT_PHASE_FIRST_UPLINK) {
+		LOG_INF("First uplink %u ms after boot", now);
+	}
+}
+
+int64_t boot_timing_get(enum boot_phase phase)
+{
+	if (!atomic_test_bit(marked, phase)) {
+		return -1;
+	}
+
+	return stamps[phase];
+}
+
+int boot_timing_json(char *buf, size_t len)
+{
+	size_t used = 0;
+	int ret;
+
+	ret = snprintk(buf, len, "{");
+	if (ret < 0 || (size_t)ret >= len) {
+		return -ENOMEM;
+	}
+	used += ret;
+
+	for (size_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+		if (!atomic_test_bit(marked, i)) {
+			continue;
+		}
+
+		ret = snprintk(buf + used, len - used, "%s\"%s\":%u", (used > 1) ? "," : "",
+			       phase_names[i], stamps[i]);
+		if (ret < 0 || (size_t)ret >= len - used) {
+			return -ENOMEM;
+		}
+		used += ret;
+	}
+
+	ret = snprintk(buf + used, len - used, "}");
+	if (ret < 0 || (size_t)ret >= len - used) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __BOOT_TIMING_H__
+#define __BOOT_TIMING_H__
+
+/** Startup phase timestamps.
+ *
+ * Each phase is stamped with the uptime (ms since the kernel started) the
+ * first time it is reached; later marks of the same phase, e.g. on a
+ * reconnect, are ignored. The stamps are sent with the startup report so
+ * the time from power-on to the first uplink can be followed in the field.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum boot_phase {
+	BOOT_PHASE_MAIN,		/* main() entered, drivers are up */
+	BOOT_PHASE_POWER_READY,		/* Fuel gauge and admission control ready */
+	BOOT_PHASE_LTE_START,		/* LTE attach requested */
+	BOOT_PHASE_INIT_DONE,		/* Init that runs during the attach finished */
+	BOOT_PHASE_LTE_REGISTERED,	/* Registered to the network */
+	BOOT_PHASE_CONNECTED,		/* Golioth session established */
+	BOOT_PHASE_FIRST_UPLINK,	/* First uplink queued */
+	BOOT_PHASE_COUNT,
+};
+
+void boot_timing_mark(enum boot_phase phase);
+/* Returns -1 for a phase that has not been reached */
+int64_t boot_timing_get(enum boot_phase phase);
+/* Writes the reached phases as a JSON object, e.g. {"main":210,"lte":640} */
+int boot_timing_json(char *buf, size_t len);
+
+#endif /* __BOOT_TIMING_H__ */
@@ -7,7 +7,9 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(cellular_nrf91);
 
+#include <stdlib.h>
 #include <modem/lte_lc.h>
+#include <nrf_modem_at.h>
 
 // #include "cellular.h"
 #include "location_tracking.h"
@@ -15,10 +17,16 @@ LOG_MODULE_REGISTER(cellular_nrf91);
 /* Indicates when individual ncellmeas operation is completed. This is internal to this file. */
 static K_SEM_DEFINE(scan_cellular_sem_ncellmeas_evt, 0, 1);
 
+/* RSRP index reported by the modem to dBm, 255 means not known */
+#define RSRP_IDX_UNKNOWN 255
+#define RSRP_IDX_TO_DBM(idx) ((int)(idx) - 140)
+
 static enum lte_lc_lte_mode lte_mode;
 static struct lte_lc_ncell neighbor_cells[CONFIG_LTE_NEIGHBOR_CELLS_MAX];
+static struct lte_lc_cell gci_cells[CONFIG_CELLULAR_GCI_CELLS_MAX];
 static struct lte_lc_cells_info scan_cellular_info = {
     .neighbor_cells = neighbor_cells,
+    .gci_cells = gci_cells,
 };
 
 static const char *lte_mode_to_str(enum lte_lc_lte_mode mode)
@@ -65,8 +73,8 @@ static void lte_ind_handler(const struct lte_lc_evt *const evt)
 
             if (evt->cells_info.current_cell.id != LTE_LC_CELL_EUTRAN_ID_INVALID)
             {
-                /* Copy current cell information. We are seeing this is not set for GCI
-                 * search sometimes but we have it for the previous normal neighbor search.
+                /* A GCI search sometimes leaves the current cell out, see
+                 * serving_cell_from_xmonitor()
                  */
                 memcpy(&scan_cellular_info.current_cell,
                        &evt->cells_info.current_cell,
@@ -76,11 +84,12 @@ static void lte_ind_handler(const struct lte_lc_evt *const evt)
             /* Copy neighbor cell information if present */
             if (evt->cells_info.ncells_count > 0 && evt->cells_info.neighbor_cells)
             {
+                scan_cellular_info.ncells_count = MIN(evt->cells_info.ncells_count,
+                                                      ARRAY_SIZE(neighbor_cells));
+
                 memcpy(scan_cellular_info.neighbor_cells,
                        evt->cells_info.neighbor_cells,
-                       sizeof(struct lte_lc_ncell) * evt->cells_info.ncells_count);
-
-                scan_cellular_info.ncells_count = evt->cells_info.ncells_count;
+                       sizeof(struct lte_lc_ncell) * scan_cellular_info.ncells_count);
             }
             else
             {
@@ -90,11 +99,12 @@ static void lte_ind_handler(const struct lte_lc_evt *const evt)
             /* Copy surrounding cell information if present */
             if (evt->cells_info.gci_cells_count > 0 && evt->cells_info.gci_cells)
             {
+                scan_cellular_info.gci_cells_count = MIN(evt->cells_info.gci_cells_count,
+                                                         ARRAY_SIZE(gci_cells));
+
                 memcpy(scan_cellular_info.gci_cells,
                        evt->cells_info.gci_cells,
-                       sizeof(struct lte_lc_cell) * evt->cells_info.gci_cells_count);
-
-                scan_cellular_info.gci_cells_count = evt->cells_info.gci_cells_count;
+                       sizeof(struct lte_lc_cell) * scan_cellular_info.gci_cells_count);
             }
             else
             {
@@ -109,47 +119,236 @@ static void lte_ind_handler(const struct lte_lc_evt *const evt)
     }
 }
 
-int cellular_info_get(struct golioth_cellular_info *infos,
-                      size_t num_max_infos,
-                      size_t *num_returned_infos)
+/* Higher is stronger, unknown sorts last */
+static int rsrp_rank(uint16_t rsrp)
+{
+    return (rsrp == RSRP_IDX_UNKNOWN) ? -1 : rsrp;
+}
+
+/* Fills the serving cell from %XMONITOR, for a measurement that did not
+ * report it. The modem answers once it is registered.
+ */
+static int serving_cell_from_xmonitor(struct lte_lc_cell *cell)
+{
+    char plmn[7] = { 0 };
+    uint32_t tac;
+    uint32_t id;
+    uint16_t phys_cell_id;
+    uint32_t earfcn;
+    uint16_t rsrp;
+    int ret;
+
+    /* %XMONITOR: <reg_status>,<full_name>,<short_name>,<plmn>,<tac>,<AcT>,
+     * <band>,<cell_id>,<phys_cell_id>,<EARFCN>,<rsrp>,...
+     */
+    ret = nrf_modem_at_scanf("AT%XMONITOR",
+                             "%%XMONITOR: %*u,%*[^,],%*[^,],\"%6[0-9]\",\"%x\",%*u,%*u,"
+                             "\"%x\",%hu,%u,%hu",
+                             plmn, &tac, &id, &phys_cell_id, &earfcn, &rsrp);
+    if (ret != 6)
+    {
+        LOG_DBG("No serving cell from %%XMONITOR (%d)", ret);
+        return -ENODATA;
+    }
+
+    cell->mnc = atoi(&plmn[3]);
+    plmn[3] = '\0';
+    cell->mcc = atoi(plmn);
+    cell->tac = tac;
+    cell->id = id;
+    cell->phys_cell_id = phys_cell_id;
+    cell->earfcn = earfcn;
+    cell->rsrp = rsrp;
+
+    return 0;
+}
+
+/* Runs one measurement and waits for its result, bounded by the timeout */
+static int cell_measure(enum lte_lc_neighbor_search_type search_type, uint8_t gci_count)
 {
     struct lte_lc_ncellmeas_params params = {
-        .search_type = LTE_LC_NEIGHBOR_SEARCH_TYPE_EXTENDED_LIGHT,
+        .search_type = search_type,
+        .gci_count = gci_count,
     };
-    struct lte_lc_cell *current = &scan_cellular_info.current_cell;
     int err;
 
+    /* Results of an earlier measurement must not leak into this one */
+    scan_cellular_info.current_cell.id = LTE_LC_CELL_EUTRAN_ID_INVALID;
+    scan_cellular_info.ncells_count = 0;
+    scan_cellular_info.gci_cells_count = 0;
+    k_sem_reset(&scan_cellular_sem_ncellmeas_evt);
+
     err = lte_lc_neighbor_cell_measurement(&params);
     if (err)
     {
         return err;
     }
 
-    err = k_sem_take(&scan_cellular_sem_ncellmeas_evt, K_FOREVER);
+    err = k_sem_take(&scan_cellular_sem_ncellmeas_evt,
+                     K_SECONDS(CONFIG_CELLULAR_MEAS_TIMEOUT_SECONDS));
     if (err)
     {
-        /* Semaphore was reset so stop search procedure */
-        err = 0;
+        LOG_WRN("Cell measurement timed out");
+        lte_lc_neighbor_cell_measurement_cancel();
+        return -ETIMEDOUT;
+    }
+
+    return 0;
+}
+
+static bool cell_info_add(struct golioth_cellular_info *infos,
+                          size_t num_max_infos,
+                          size_t *count,
+                          enum golioth_cellular_type type,
+                          const struct lte_lc_cell *cell)
+{
+    if (*count >= num_max_infos || cell->id == LTE_LC_CELL_EUTRAN_ID_INVALID)
+    {
+        return false;
+    }
+
+    /* The serving cell may also be reported by the GCI search */
+    for (size_t i = 0; i < *count; i++)
+    {
+        if (infos[i].id == cell->id && infos[i].mcc == cell->mcc && infos[i].mnc == cell->mnc)
+        {
+            return false;
+        }
     }
 
+    infos[*count].type = type;
+    infos[*count].mcc = cell->mcc;
+    infos[*count].mnc = cell->mnc;
+    infos[*count].id = cell->id;
+    infos[*count].strength = (cell->rsrp == RSRP_IDX_UNKNOWN) ? 0 : RSRP_IDX_TO_DBM(cell->rsrp);
+    (*count)++;
+
+    return true;
+}
+
+int cellular_info_get(struct golioth_cellular_info *infos,
+                      size_t num_max_infos,
+                      size_t *num_returned_infos)
+{
+    enum golioth_cellular_type type;
+    bool used[CONFIG_CELLULAR_GCI_CELLS_MAX] = { false };
+    uint8_t gci_count;
+    int err;
+
+    *num_returned_infos = 0;
+
     switch (lte_mode)
     {
         case LTE_LC_LTE_MODE_LTEM:
-            infos[0].type = GOLIOTH_CELLULAR_TYPE_LTECATM;
+            type = GOLIOTH_CELLULAR_TYPE_LTECATM;
             break;
         case LTE_LC_LTE_MODE_NBIOT:
-            infos[0].type = GOLIOTH_CELLULAR_TYPE_NBIOT;
+            type = GOLIOTH_CELLULAR_TYPE_NBIOT;
             break;
         default:
-            *num_returned_infos = 0;
             return 0;
     }
 
-    infos[0].mcc = current->mcc;
-    infos[0].mnc = current->mnc;
-    infos[0].id = current->id;
+    /* Neighbors found by a plain search have no cell ID, which the location
+     * service needs, so ask for surrounding cells with their global IDs.
+     * The modem takes at least two.
+     */
+    gci_count = CLAMP(num_max_infos, 2, CONFIG_CELLULAR_GCI_CELLS_MAX);
+
+    err = cell_measure(LTE_LC_NEIGHBOR_SEARCH_TYPE_GCI_EXTENDED_LIGHT, gci_count);
+    if (err && err != -ETIMEDOUT)
+    {
+        /* Older modem firmware only knows the serving cell search */
+        LOG_DBG("GCI search failed (%d), using serving cell only", err);
+        err = cell_measure(LTE_LC_NEIGHBOR_SEARCH_TYPE_EXTENDED_LIGHT, 0);
+    }
+    if (err)
+    {
+        return err;
+    }
+
+    if (scan_cellular_info.current_cell.id == LTE_LC_CELL_EUTRAN_ID_INVALID)
+    {
+        serving_cell_from_xmonitor(&scan_cellular_info.current_cell);
+    }
+
+    cell_info_add(infos, num_max_infos, num_returned_infos, type,
+                  &scan_cellular_info.current_cell);
+
+    /* Strongest surrounding cells first */
+    while (*num_returned_infos < num_max_infos)
+    {
+        int best = -1;
+
+        for (size_t i = 0; i < scan_cellular_info.gci_cells_count; i++)
+        {
+            if (!used[i] &&
+                (best < 0 || rsrp_rank(gci_cells[i].rsrp) > rsrp_rank(gci_cells[best].rsrp)))
+            {
+                best = i;
+            }
+        }
+
+        if (best < 0)
+        {
+            break;
+        }
+
+        used[best] = true;
+        cell_info_add(infos, num_max_infos, num_returned_infos, type, &gci_cells[best]);
+    }
 
-    *num_returned_infos = 1;
+    LOG_DBG("%u cells for the location request", *num_returned_infos);
+
+    return 0;
+}
+
+/* EARFCN and PCI (9 bits) of one cell */
+static uint32_t cell_key(uint32_t earfcn, uint16_t phys_cell_id)
+{
+    return (earfcn << 9) | (phys_cell_id & 0x1ff);
+}
+
+int cellular_fingerprint_get(struct cell_fingerprint *fp)
+{
+    const struct lte_lc_cell *current = &scan_cellular_info.current_cell;
+
+    if (current->id == LTE_LC_CELL_EUTRAN_ID_INVALID)
+    {
+        return -ENODATA;
+    }
+
+    memset(fp, 0, sizeof(*fp));
+    fp->mcc = current->mcc;
+    fp->mnc = current->mnc;
+    fp->tac = current->tac;
+    fp->cell_id = current->id;
+    fp->cells[fp->count++] = cell_key(current->earfcn, current->phys_cell_id);
+
+    for (size_t i = 0; i < scan_cellular_info.ncells_count &&
+                       fp->count < CELL_FINGERPRINT_MAX_CELLS; i++)
+    {
+        fp->cells[fp->count++] = cell_key(neighbor_cells[i].earfcn,
+                                          neighbor_cells[i].phys_cell_id);
+    }
+
+    for (size_t i = 0; i < scan_cellular_info.gci_cells_count &&
+                       fp->count < CELL_FINGERPRINT_MAX_CELLS; i++)
+    {
+        uint32_t key = cell_key(gci_cells[i].earfcn, gci_cells[i].phys_cell_id);
+        bool seen = false;
+
+        /* The serving cell is usually among the surrounding cells */
+        for (size_t j = 0; j < fp->count; j++)
+        {
+            seen |= (fp->cells[j] == key);
+        }
+
+        if (!seen)
+        {
+            fp->cells[fp->count++] = key;
+        }
+    }
 
     return 0;
 }
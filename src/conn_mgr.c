@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(conn_mgr, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/atomic.h>
+#include <golioth/client.h>
+#include <modem/lte_lc.h>
+#if defined(CONFIG_CONN_RAI_HINT)
+#include <zephyr/net/socket.h>
+#include <zephyr/net/socket_ncs.h>
+#endif
+#include "admission.h"
+#include "conn_mgr.h"
+#include "energy_ledger.h"
+#include "main.h"
+
+/* Poll period while waiting for queued requests to leave */
+#define DRAIN_POLL_MS 100
+#define BUDGET_WINDOW_MS ((int64_t)CONFIG_CONN_FAILED_BUDGET_WINDOW_SECONDS * MSEC_PER_SEC)
+
+static K_MUTEX_DEFINE(conn_lock);
+static K_SEM_DEFINE(lte_sem, 0, 1);
+static K_SEM_DEFINE(cloud_sem, 0, 1);
+
+static atomic_t lte_up;
+static atomic_t cloud_up;
+/* Async requests sent and not answered yet */
+static atomic_t in_flight;
+
+/* Everything below is protected by conn_lock */
+static enum conn_state state = CONN_STATE_OFFLINE;
+static conn_mgr_client_create_fn client_create;
+static unsigned int users;
+static bool metering;
+static int64_t attach_started;
+static int64_t retry_at;
+static uint32_t backoff_s;
+
+#if defined(CONFIG_ENERGY_LEDGER)
+static float failed_mj;
+static int64_t budget_window_start;
+#endif
+
+static const char *const state_names[] = {
+	[CONN_STATE_OFFLINE] = "offline",
+	[CONN_STATE_ATTACHING] = "attaching",
+	[CONN_STATE_DTLS] = "dtls",
+	[CONN_STATE_READY] = "ready",
+	[CONN_STATE_IDLE] = "idle",
+};
+
+const char *conn_mgr_state_str(enum conn_state s)
+{
+	return state_names[s];
+}
+
+static void set_state(enum conn_state new_state)
+{
+	if (state != new_state) {
+		LOG_DBG("%s -> %s", state_names[state], state_names[new_state]);
+		state = new_state;
+	}
+}
+
+static void lte_evt_handler(const struct lte_lc_evt *const evt)
+{
+	if (evt->type != LTE_LC_EVT_NW_REG_STATUS) {
+		return;
+	}
+
+	switch (evt->nw_reg_status) {
+	case LTE_LC_NW_REG_REGISTERED_HOME:
+	case LTE_LC_NW_REG_REGISTERED_ROAMING:
+		atomic_set(&lte_up, 1);
+		k_sem_give(&lte_sem);
+		break;
+	default:
+		atomic_set(&lte_up, 0);
+		break;
+	}
+}
+
+void conn_mgr_client_event(bool connected)
+{
+	atomic_set(&cloud_up, connected);
+
+	if (connected) {
+		k_sem_give(&cloud_sem);
+	}
+}
+
+void conn_mgr_request_sent(void)
+{
+	atomic_inc(&in_flight);
+}
+
+void conn_mgr_request_done(void)
+{
+	atomic_val_t n;
+
+	/* Requests cancelled by golioth_client_stop() were already dropped */
+	do {
+		n = atomic_get(&in_flight);
+	} while (n > 0 && !atomic_cas(&in_flight, n, n - 1));
+}
+
+static void meter_begin(void)
+{
+	if (!metering) {
+		IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_begin(ENERGY_LEDGER_OP_CONNECT);));
+		metering = true;
+	}
+}
+
+static void meter_end(void)
+{
+	if (metering) {
+		IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_end(ENERGY_LEDGER_OP_CONNECT);));
+		metering = false;
+	}
+}
+
+static uint32_t jittered_ms(uint32_t base_s)
+{
+	uint32_t base_ms = base_s * MSEC_PER_SEC;
+	uint32_t spread_ms = base_ms / 100 * CONFIG_CONN_BACKOFF_JITTER_PCT;
+
+	if (spread_ms == 0) {
+		return base_ms;
+	}
+
+	/* Uniform in [base - spread, base + spread] */
+	return base_ms - spread_ms + sys_rand32_get() % (2 * spread_ms + 1);
+}
+
+#if defined(CONFIG_ENERGY_LEDGER)
+/* Returns true when failed attempts have used up the budget of this window */
+static bool failed_budget_spent(int64_t now)
+{
+	struct energy_ledger_entry entry;
+
+	if (now - budget_window_start >= BUDGET_WINDOW_MS) {
+		budget_window_start = now;
+		failed_mj = 0.0f;
+	}
+
+	energy_ledger_get(ENERGY_LEDGER_OP_CONNECT, &entry);
+	if (entry.last_mj > 0.0f) {
+		failed_mj += entry.last_mj;
+	}
+
+	return failed_mj >= CONFIG_CONN_FAILED_BUDGET_MJ;
+}
+#endif
+
+static void attempt_failed(const char *what)
+{
+	int64_t now = k_uptime_get();
+
+	meter_end();
+
+	backoff_s = backoff_s ? MIN(backoff_s * 2, CONFIG_CONN_BACKOFF_MAX_SECONDS)
+			      : CONFIG_CONN_BACKOFF_MIN_SECONDS;
+	retry_at = now + jittered_ms(backoff_s);
+
+#if defined(CONFIG_ENERGY_LEDGER)
+	if (failed_budget_spent(now)) {
+		int64_t window_end = budget_window_start + BUDGET_WINDOW_MS;
+
+		retry_at = MAX(retry_at, window_end);
+		LOG_WRN("Failed connection budget spent (%d mJ)", (int)failed_mj);
+	}
+#endif
+
+	LOG_WRN("%s failed, next attempt in %lld s", what, (retry_at - now) / MSEC_PER_SEC);
+}
+
+static bool backing_off(void)
+{
+	return k_uptime_get() < retry_at;
+}
+
+static bool connect_admitted(void)
+{
+#if defined(CONFIG_ADMISSION_CONTROL)
+	return admission_check(ENERGY_LEDGER_OP_CONNECT, 1) == ADMISSION_ADMIT;
+#else
+	return true;
+#endif
+}
+
+static int attach_start(void)
+{
+	int err;
+
+	if (backing_off()) {
+		return -EAGAIN;
+	}
+
+	/* An attach that browns out half way wastes everything it spent */
+	if (!connect_admitted()) {
+		return -EBUSY;
+	}
+
+	meter_begin();
+	k_sem_reset(&lte_sem);
+
+	err = lte_lc_connect_async(lte_evt_handler);
+	if (err) {
+		LOG_ERR("Failed to start LTE attach: %d", err);
+		attempt_failed("Attach");
+		return err;
+	}
+
+	attach_started = k_uptime_get();
+	set_state(CONN_STATE_ATTACHING);
+
+	return 0;
+}
+
+int conn_mgr_start(void)
+{
+	int err = 0;
+
+	k_mutex_lock(&conn_lock, K_FOREVER);
+
+	if (state == CONN_STATE_OFFLINE) {
+		err = attach_start();
+	}
+
+	k_mutex_unlock(&conn_lock);
+
+	return err;
+}
+
+static int attach_wait(void)
+{
+	int64_t deadline = attach_started +
+			   (int64_t)CONFIG_CONN_ATTACH_TIMEOUT_SECONDS * MSEC_PER_SEC;
+	int64_t remaining = deadline - k_uptime_get();
+
+	if (!atomic_get(&lte_up) && remaining > 0) {
+		k_sem_take(&lte_sem, K_MSEC(remaining));
+	}
+
+	if (!atomic_get(&lte_up)) {
+		/* Stop the modem from searching until the next attempt */
+		lte_lc_offline();
+		attempt_failed("Attach");
+		set_state(CONN_STATE_OFFLINE);
+		return -ETIMEDOUT;
+	}
+
+	set_state(CONN_STATE_DTLS);
+
+	return 0;
+}
+
+static int session_wait(void)
+{
+	if (!atomic_get(&cloud_up)) {
+		k_sem_reset(&cloud_sem);
+
+		if (!client) {
+			client_create();
+		} else if (!golioth_client_is_running(client)) {
+			golioth_client_start(client);
+		}
+
+		k_sem_take(&cloud_sem, K_SECONDS(CONFIG_CONN_DTLS_TIMEOUT_SECONDS));
+	}
+
+	if (!atomic_get(&cloud_up)) {
+		if (client) {
+			golioth_client_stop(client);
+		}
+		lte_lc_offline();
+		attempt_failed("Golioth connection");
+		set_state(CONN_STATE_OFFLINE);
+		return -ETIMEDOUT;
+	}
+
+	meter_end();
+	backoff_s = 0;
+	retry_at = 0;
+	set_state(CONN_STATE_READY);
+
+	return 0;
+}
+
+int conn_mgr_acquire(void)
+{
+	int err = 0;
+
+	k_mutex_lock(&conn_lock, K_FOREVER);
+
+	/* The link may have dropped since it was last used */
+	if (state == CONN_STATE_READY && !atomic_get(&cloud_up)) {
+		meter_begin();
+		if (atomic_get(&lte_up)) {
+			set_state(CONN_STATE_DTLS);
+		} else {
+			attach_started = k_uptime_get();
+			set_state(CONN_STATE_ATTACHING);
+		}
+	}
+
+	switch (state) {
+	case CONN_STATE_IDLE:
+		if (backing_off()) {
+			err = -EAGAIN;
+			break;
+		}
+		if (!connect_admitted()) {
+			err = -EBUSY;
+			break;
+		}
+		meter_begin();
+		if (atomic_get(&lte_up)) {
+			set_state(CONN_STATE_DTLS);
+		} else {
+			/* The modem re-attaches on its own once it wakes */
+			attach_started = k_uptime_get();
+			set_state(CONN_STATE_ATTACHING);
+		}
+		break;
+	case CONN_STATE_OFFLINE:
+		err = attach_start();
+		break;
+	default:
+		break;
+	}
+
+	if (!err && state == CONN_STATE_ATTACHING) {
+		err = attach_wait();
+	}
+
+	if (!err && state == CONN_STATE_DTLS) {
+		err = session_wait();
+	}
+
+	if (!err) {
+		users++;
+	}
+
+	k_mutex_unlock(&conn_lock);
+
+	return err;
+}
+
+/* Requests are sent asynchronously, give them a chance to leave the device
+ * and to be answered: stopping the client cancels a request that is still
+ * waiting for its ACK. Returns false when some are still outstanding.
+ */
+static bool drain_requests(void)
+{
+	int64_t deadline = k_uptime_get() + CONFIG_CONN_DRAIN_TIMEOUT_MS;
+
+	while (atomic_get(&cloud_up) &&
+	       (golioth_client_num_items_in_request_queue(client) > 0 ||
+		atomic_get(&in_flight) > 0)) {
+		if (k_uptime_get() >= deadline) {
+			return false;
+		}
+		k_msleep(DRAIN_POLL_MS);
+	}
+
+	return true;
+}
+
+#if defined(CONFIG_CONN_RAI_HINT)
+/* The Golioth socket is private to the client, but the release assistance
+ * indication applies to the whole RRC connection, so any socket will do.
+ */
+static void rai_no_more_data(void)
+{
+	int rai = RAI_NO_DATA;
+	int fd;
+
+	fd = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (fd < 0) {
+		LOG_WRN("RAI socket, error: %d", errno);
+		return;
+	}
+
+	if (zsock_setsockopt(fd, SOL_SOCKET, SO_RAI, &rai, sizeof(rai))) {
+		LOG_WRN("RAI not sent, error: %d", errno);
+	} else {
+		LOG_DBG("RAI: no more data");
+	}
+
+	zsock_close(fd);
+}
+#endif
+
+void conn_mgr_release(uint32_t idle_s)
+{
+	k_mutex_lock(&conn_lock, K_FOREVER);
+
+	if (users > 0) {
+		users--;
+	}
+
+	if (users == 0 && state == CONN_STATE_READY &&
+	    idle_s >= CONFIG_CONN_IDLE_STOP_MIN_SECONDS) {
+		bool drained = drain_requests();
+
+		golioth_client_stop(client);
+		/* Whatever was still outstanding is gone with the session */
+		atomic_clear(&in_flight);
+		set_state(CONN_STATE_IDLE);
+		LOG_INF("Golioth client stopped for %u s", idle_s);
+
+#if defined(CONFIG_CONN_RAI_HINT)
+		/* Every request has been answered, so no ACK or CoAP
+		 * retransmission needs the RRC connection any more. After a
+		 * drain timeout the network's inactivity timer decides.
+		 */
+		if (drained) {
+			rai_no_more_data();
+		}
+#else
+		ARG_UNUSED(drained);
+#endif
+	}
+
+	k_mutex_unlock(&conn_lock);
+}
+
+enum conn_state conn_mgr_state(void)
+{
+	enum conn_state current;
+
+	k_mutex_lock(&conn_lock, K_FOREVER);
+	current = state;
+	k_mutex_unlock(&conn_lock);
+
+	return current;
+}
+
+void conn_mgr_init(conn_mgr_client_create_fn create)
+{
+	client_create = create;
+}
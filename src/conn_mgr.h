@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __CONN_MGR_H__
+#define __CONN_MGR_H__
+
+/** Connection lifecycle.
+ *
+ * The link to Golioth moves through these states:
+ *
+ *   OFFLINE   -> ATTACHING  LTE attach requested
+ *   ATTACHING -> DTLS       registered, Golioth client started
+ *   DTLS      -> READY      Golioth session up
+ *   READY     -> IDLE       client stopped, LTE left to sleep in PSM
+ *   IDLE      -> DTLS       client restarted for the next window
+ *
+ * Users bracket their traffic with `conn_mgr_acquire()` and
+ * `conn_mgr_release()`. Acquiring brings the link up, or fails quickly.
+ * When the last user releases and the next window is at least
+ * `CONFIG_CONN_IDLE_STOP_MIN_SECONDS` away, queued requests are drained and
+ * the client is stopped. Async requests are counted with
+ * `conn_mgr_request_sent()` and `conn_mgr_request_done()`, so the drain also
+ * waits for their ACKs, up to `CONFIG_CONN_DRAIN_TIMEOUT_MS`. Without this,
+ * the session would be kept open until the client's receive timeout expires.
+ *
+ * A failed attach or handshake returns the modem to flight mode, so it
+ * stops searching, and holds off the next attempt with exponential backoff
+ * and random jitter. Attempts are also refused while admission control
+ * reports too little energy. With the energy ledger, failed attempts share a
+ * budget (`CONFIG_CONN_FAILED_BUDGET_MJ` per
+ * `CONFIG_CONN_FAILED_BUDGET_WINDOW_SECONDS`). This keeps a unit in bad
+ * coverage from draining itself.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum conn_state {
+	CONN_STATE_OFFLINE,
+	CONN_STATE_ATTACHING,
+	CONN_STATE_DTLS,
+	CONN_STATE_READY,
+	CONN_STATE_IDLE,
+};
+
+typedef void (*conn_mgr_client_create_fn)(void);
+
+/* create is called once, the first time a Golioth client is needed */
+void conn_mgr_init(conn_mgr_client_create_fn create);
+/* Requests the attach without waiting for it */
+int conn_mgr_start(void);
+/* Returns 0 once connected, -EAGAIN while backing off, -EBUSY when the
+ * energy is not there, or -ETIMEDOUT when this attempt failed.
+ */
+int conn_mgr_acquire(void);
+/* idle_s: time until the caller needs the link again */
+void conn_mgr_release(uint32_t idle_s);
+enum conn_state conn_mgr_state(void);
+const char *conn_mgr_state_str(enum conn_state state);
+/* Bracket an async Golioth request, done is called from its callback */
+void conn_mgr_request_sent(void);
+void conn_mgr_request_done(void);
+/* Called from the Golioth client event callback */
+void conn_mgr_client_event(bool connected);
+
+#endif /* __CONN_MGR_H__ */
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(energy_ledger, LOG_LEVEL_DBG);
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <golioth/client.h>
+#include <golioth/stream.h>
+#include <zcbor_encode.h>
+#include "energy_ledger.h"
+#include "fuel_gauge.h"
+#include "conn_mgr.h"
+#include "radio_window.h"
+
+#define ENERGY_ENDP          "energy"
+#define ENTRY_MAP_ENTRIES    5
+#define KEY_MAX_LEN          12
+#define REPORT_CBOR_MAX_SIZE 384
+#define MARK_MAX_MS          ((int64_t)CONFIG_ENERGY_LEDGER_MARK_MAX_SECONDS * MSEC_PER_SEC)
+
+/* Running integral of an open operation */
+struct energy_ledger_mark {
+	bool active;
+	int64_t start;
+	int64_t last;		/* Uptime of the last reading */
+	float power;		/* Last reading, V * A = W */
+	float energy_mj;
+};
+
+static struct golioth_client *client;
+static struct energy_ledger_mark marks[ENERGY_LEDGER_OP_COUNT];
+static struct energy_ledger_entry entries[ENERGY_LEDGER_OP_COUNT];
+/* Uptime of the last report, shifted back by the time spent hibernating */
+static int64_t last_report;
+/* Delay of the first report after boot */
+static int64_t first_report_ms =
+	(int64_t)CONFIG_ENERGY_LEDGER_REPORT_INTERVAL_SECONDS * MSEC_PER_SEC;
+
+/* Protects marks and entries, operations begin and end on several threads */
+static K_MUTEX_DEFINE(ledger_lock);
+
+static void report_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(report_work, report_work_handler);
+static void sample_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_work_handler);
+
+const char *energy_ledger_op_str(enum energy_ledger_op op)
+{
+	switch (op) {
+	case ENERGY_LEDGER_OP_CONNECT:
+		return "connect";
+	case ENERGY_LEDGER_OP_SENSOR_READ:
+		return "sensor";
+	case ENERGY_LEDGER_OP_TX:
+		return "tx";
+	case ENERGY_LEDGER_OP_CELL_MEAS:
+		return "cellmeas";
+	case ENERGY_LEDGER_OP_LOCATION:
+		return "location";
+	default:
+		break;
+	}
+
+	return "unknown";
+}
+
+/* Adds the slice since the last reading to every open operation, with the
+ * trapezoidal rule. Call with ledger_lock held.
+ */
+static bool marks_integrate(int64_t now, float power)
+{
+	bool any_active = false;
+
+	for (int op = 0; op < ENERGY_LEDGER_OP_COUNT; op++) {
+		struct energy_ledger_mark *mark = &marks[op];
+
+		if (!mark->active) {
+			continue;
+		}
+
+		/* An end that never comes, e.g. a lost response callback, must
+		 * not keep the PMIC sampled; the operation is not booked.
+		 */
+		if (now - mark->start > MARK_MAX_MS) {
+			LOG_WRN("%s: no end after %d s, discarded", energy_ledger_op_str(op),
+				CONFIG_ENERGY_LEDGER_MARK_MAX_SECONDS);
+			mark->active = false;
+			continue;
+		}
+
+		/* W * ms = mJ */
+		mark->energy_mj += 0.5f * (mark->power + power) * (float)(now - mark->last);
+		mark->last = now;
+		mark->power = power;
+		any_active = true;
+	}
+
+	return any_active;
+}
+
+/* Samples the load while any operation is open, so bursts within it, e.g.
+ * the attach or the RRC tail, are part of its energy.
+ */
+static void sample_work_handler(struct k_work *work)
+{
+	float voltage;
+	float current;
+	bool any_active;
+	bool sampled;
+
+	sampled = (fuel_gauge_power_sample(&voltage, &current) == 0);
+
+	k_mutex_lock(&ledger_lock, K_FOREVER);
+	if (sampled) {
+		any_active = marks_integrate(k_uptime_get(), voltage * current);
+	} else {
+		/* A missed reading only widens the next slice */
+		any_active = false;
+		for (int op = 0; op < ENERGY_LEDGER_OP_COUNT; op++) {
+			any_active |= marks[op].active;
+		}
+	}
+	k_mutex_unlock(&ledger_lock);
+
+	if (any_active) {
+		k_work_schedule(&sample_work, K_MSEC(CONFIG_ENERGY_LEDGER_SAMPLE_MS));
+	}
+}
+
+void energy_ledger_begin(enum energy_ledger_op op)
+{
+	float voltage;
+	float current;
+	int64_t now;
+
+	if (op >= ENERGY_LEDGER_OP_COUNT || fuel_gauge_power_sample(&voltage, &current)) {
+		return;
+	}
+
+	k_mutex_lock(&ledger_lock, K_FOREVER);
+	now = k_uptime_get();
+	marks_integrate(now, voltage * current);
+
+	/* Beginning again before the end restarts the measurement, e.g. a
+	 * reconnect attempt while the previous attach never completed.
+	 */
+	marks[op].active = true;
+	marks[op].start = now;
+	marks[op].last = now;
+	marks[op].power = voltage * current;
+	marks[op].energy_mj = 0.f;
+	k_mutex_unlock(&ledger_lock);
+
+	/* Already running when another operation is open */
+	k_work_schedule(&sample_work, K_MSEC(CONFIG_ENERGY_LEDGER_SAMPLE_MS));
+}
+
+void energy_ledger_end(enum energy_ledger_op op)
+{
+	struct energy_ledger_entry *entry;
+	struct energy_ledger_mark *mark;
+	float voltage;
+	float current;
+	int64_t elapsed;
+	float energy_mj;
+
+	if (op >= ENERGY_LEDGER_OP_COUNT || fuel_gauge_power_sample(&voltage, &current)) {
+		return;
+	}
+
+	k_mutex_lock(&ledger_lock, K_FOREVER);
+
+	mark = &marks[op];
+	if (mark->active) {
+		marks_integrate(k_uptime_get(), voltage * current);
+	}
+	/* Also false when the mark just ran past its maximum */
+	if (!mark->active) {
+		k_mutex_unlock(&ledger_lock);
+		return;
+	}
+
+	elapsed = mark->last - mark->start;
+	energy_mj = mark->energy_mj;
+	mark->active = false;
+
+	entry = &entries[op];
+	entry->max_mj = (entry->count == 0) ? energy_mj : MAX(entry->max_mj, energy_mj);
+	entry->count++;
+	entry->total_ms += (uint32_t)elapsed;
+	entry->total_mj += energy_mj;
+	entry->last_mj = energy_mj;
+
+	k_mutex_unlock(&ledger_lock);
+
+	LOG_DBG("%s: %.1f mJ in %lld ms", energy_ledger_op_str(op), (double)energy_mj, elapsed);
+}
+
+void energy_ledger_get(enum energy_ledger_op op, struct energy_ledger_entry *entry)
+{
+	if (op >= ENERGY_LEDGER_OP_COUNT) {
+		return;
+	}
+
+	k_mutex_lock(&ledger_lock, K_FOREVER);
+	*entry = entries[op];
+	k_mutex_unlock(&ledger_lock);
+}
+
+static bool encode_entry(zcbor_state_t *zse, enum energy_ledger_op op)
+{
+	struct energy_ledger_entry entry;
+
+	energy_ledger_get(op, &entry);
+
+	return zcbor_tstr_put_term(zse, energy_ledger_op_str(op), KEY_MAX_LEN) &&
+	       zcbor_map_start_encode(zse, ENTRY_MAP_ENTRIES) &&
+	       zcbor_tstr_put_lit(zse, "n") && zcbor_uint32_put(zse, entry.count) &&
+	       zcbor_tstr_put_lit(zse, "ms") && zcbor_uint32_put(zse, entry.total_ms) &&
+	       zcbor_tstr_put_lit(zse, "mJ") && zcbor_float32_put(zse, entry.total_mj) &&
+	       zcbor_tstr_put_lit(zse, "last") && zcbor_float32_put(zse, entry.last_mj) &&
+	       zcbor_tstr_put_lit(zse, "max") && zcbor_float32_put(zse, entry.max_mj) &&
+	       zcbor_map_end_encode(zse, ENTRY_MAP_ENTRIES);
+}
+
+static void report_handler(struct golioth_client *client, enum golioth_status status,
+			   const struct golioth_coap_rsp_code *coap_rsp_code, const char *path,
+			   void *arg)
+{
+	conn_mgr_request_done();
+
+	if (status != GOLIOTH_OK) {
+		LOG_WRN("Energy report not acknowledged: %d", status);
+	}
+}
+
+static int energy_ledger_report(void)
+{
+	uint8_t cbor_buf[REPORT_CBOR_MAX_SIZE];
+	enum golioth_status status;
+	bool ok;
+
+	if (!client || !golioth_client_is_connected(client)) {
+		LOG_DBG("No connection available, delaying energy report");
+		return -ENOTCONN;
+	}
+
+	ZCBOR_STATE_E(zse, 2, cbor_buf, sizeof(cbor_buf), 1);
+
+	ok = zcbor_map_start_encode(zse, ENERGY_LEDGER_OP_COUNT);
+	for (int op = 0; ok && op < ENERGY_LEDGER_OP_COUNT; op++) {
+		ok = encode_entry(zse, op);
+	}
+	ok = ok && zcbor_map_end_encode(zse, ENERGY_LEDGER_OP_COUNT);
+
+	if (!ok) {
+		LOG_ERR("ZCBOR failed to encode energy report");
+		return -ENOMEM;
+	}
+
+	size_t cbor_size = zse->payload - cbor_buf;
+
+	conn_mgr_request_sent();
+	status = golioth_stream_set_async(client, ENERGY_ENDP, GOLIOTH_CONTENT_TYPE_CBOR,
+					  cbor_buf, cbor_size, report_handler, NULL);
+	if (status != GOLIOTH_OK) {
+		conn_mgr_request_done();
+		LOG_ERR("Failed to send energy report: %d", status);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* The report is only due here; it goes out in the next radio window */
+static void report_work_handler(struct k_work *work)
+{
+	radio_window_request(RADIO_INTENT_ENERGY_REPORT);
+}
+
+static void energy_report(bool online)
+{
+	/* Stays pending for the next window until it has been sent */
+	if (!online || energy_ledger_report() == -ENOTCONN) {
+		radio_window_request(RADIO_INTENT_ENERGY_REPORT);
+		return;
+	}
+	last_report = k_uptime_get();
+
+	k_work_schedule(&report_work, K_SECONDS(CONFIG_ENERGY_LEDGER_REPORT_INTERVAL_SECONDS));
+}
+
+void energy_ledger_set_client(struct golioth_client *ledger_client)
+{
+	client = ledger_client;
+
+	radio_window_register(RADIO_INTENT_ENERGY_REPORT, energy_report);
+	k_work_schedule(&report_work, K_MSEC(first_report_ms));
+}
+
+void energy_ledger_suspend(struct energy_ledger_resume *state)
+{
+	k_mutex_lock(&ledger_lock, K_FOREVER);
+	memcpy(state->entries, entries, sizeof(entries));
+	k_mutex_unlock(&ledger_lock);
+
+	state->unreported_s = (uint32_t)((k_uptime_get() - last_report) / MSEC_PER_SEC);
+}
+
+/* Must run before energy_ledger_set_client() so the first report keeps the
+ * interval across the power down.
+ */
+void energy_ledger_resume(const struct energy_ledger_resume *state, int64_t slept_ms)
+{
+	int64_t due_ms = (int64_t)CONFIG_ENERGY_LEDGER_REPORT_INTERVAL_SECONDS * MSEC_PER_SEC -
+			 (int64_t)state->unreported_s * MSEC_PER_SEC - slept_ms;
+
+	k_mutex_lock(&ledger_lock, K_FOREVER);
+	memcpy(entries, state->entries, sizeof(entries));
+	k_mutex_unlock(&ledger_lock);
+
+	last_report = k_uptime_get() - (int64_t)state->unreported_s * MSEC_PER_SEC - slept_ms;
+	first_report_ms = MAX(due_ms, 0);
+}
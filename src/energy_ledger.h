@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __ENERGY_LEDGER_H__
+#define __ENERGY_LEDGER_H__
+
+/** Per-operation energy accounting.
+ *
+ * Each costly operation is bracketed by `energy_ledger_begin()` and
+ * `energy_ledger_end()`. Both take a fresh voltage/current reading from the
+ * nPM1300 (see `fuel_gauge_power_sample()`), and while any operation is open
+ * the load is also sampled every `CONFIG_ENERGY_LEDGER_SAMPLE_MS` from the
+ * system workqueue. The energy drawn from the supercapacitor is the
+ * trapezoidal integral over all those readings.
+ *
+ * Each reading is a single charger ADC conversion, not an average over the
+ * period. Phases of the operation that last longer than the sample period
+ * (attach, DTLS handshake, RRC inactivity tail) are resolved; shorter
+ * bursts, such as a single TX slot, only show up when a reading falls on
+ * them, so they are captured on average over many operations rather than
+ * in each one.
+ * Counters are cumulative since boot and are streamed to the `energy` path
+ * every `CONFIG_ENERGY_LEDGER_REPORT_INTERVAL_SECONDS`.
+ *
+ * Energy is net of harvest: an operation that runs while the solar panel
+ * supplies more than the load may be booked as negative.
+ */
+
+#include <stdint.h>
+#include <golioth/client.h>
+
+enum energy_ledger_op {
+	ENERGY_LEDGER_OP_CONNECT,
+	ENERGY_LEDGER_OP_SENSOR_READ,
+	ENERGY_LEDGER_OP_TX,
+	ENERGY_LEDGER_OP_CELL_MEAS,
+	ENERGY_LEDGER_OP_LOCATION,
+	ENERGY_LEDGER_OP_COUNT,
+};
+
+struct energy_ledger_entry {
+	uint32_t count;		/* Completed operations */
+	uint32_t total_ms;	/* Time spent in the operation */
+	float total_mj;
+	float last_mj;
+	float max_mj;
+};
+
+/** Counters carried across a hibernate, see hibernate.h */
+struct energy_ledger_resume {
+	struct energy_ledger_entry entries[ENERGY_LEDGER_OP_COUNT];
+	uint32_t unreported_s;	/* Time since the last report at suspend */
+};
+
+void energy_ledger_begin(enum energy_ledger_op op);
+void energy_ledger_end(enum energy_ledger_op op);
+void energy_ledger_get(enum energy_ledger_op op, struct energy_ledger_entry *entry);
+const char *energy_ledger_op_str(enum energy_ledger_op op);
+void energy_ledger_set_client(struct golioth_client *ledger_client);
+void energy_ledger_suspend(struct energy_ledger_resume *state);
+void energy_ledger_resume(const struct energy_ledger_resume *state, int64_t slept_ms);
+
+#endif /* __ENERGY_LEDGER_H__ */
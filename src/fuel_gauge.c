@@ -17,6 +17,10 @@
 #include <zephyr/sys/util.h>
 #include "nrf_fuel_gauge.h"
 #include "fuel_gauge.h"
+#include "supercap.h"
+#include "harvest.h"
+#include "admission.h"
+#include "power_domain.h"
 #include "app_sensors.h"
 
 #if defined(CONFIG_NRF_FUEL_GAUGE)
@@ -25,8 +29,12 @@ LOG_MODULE_REGISTER(battery, LOG_LEVEL_DBG);
 
 static const struct device *pmic = DEVICE_DT_GET(DT_INST(0, nordic_npm1300));
 static const struct device *charger = DEVICE_DT_GET(DT_NODELABEL(pmic_charger));
+#if !defined(CONFIG_POWER_DOMAIN_MANAGER)
 /* For settig up 3V3 regulator */
 static const struct device *buck2 = DEVICE_DT_GET(DT_NODELABEL(reg_3v3));
+/* The rail was on when turn_off_regulators() ran */
+static bool buck2_restore;
+#endif
 
 static volatile bool vbus_connected;
 
@@ -43,6 +51,14 @@ static float term_charge_current;
 static int64_t ref_time;
 static struct battery_data batt_data;
 
+/* Protects batt_data between the gauge work item and its readers */
+static K_MUTEX_DEFINE(fuel_gauge_lock);
+/* Serializes charger fetch/get sequences between the gauge and power samples */
+static K_MUTEX_DEFINE(charger_lock);
+
+static void fuel_gauge_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(fuel_gauge_work, fuel_gauge_work_handler);
+
 static const struct battery_model battery_model = {
 #include "battery_model.inc"
 };
@@ -65,6 +81,8 @@ static void event_callback(const struct device *dev, struct gpio_callback *cb, u
 	vbus_connected = (pins & BIT(NPM1300_EVENT_VBUS_DETECTED)) ? true :
 					 (pins & BIT(NPM1300_EVENT_VBUS_REMOVED)) ? false : vbus_connected;
 	LOG_DBG("Vbus %s", vbus_connected ? "connected" : "removed");
+
+	IF_ENABLED(CONFIG_HARVEST_TRACKER, (harvest_vbus_event(vbus_connected);));
 }
 
 static inline float get_sensor_value(const struct device *dev, enum sensor_channel chan)
@@ -95,41 +113,129 @@ static int fuel_gauge_init_params(const struct device *charger)
 	max_charge_current = get_sensor_value(charger, SENSOR_CHAN_GAUGE_DESIRED_CHARGING_CURRENT);
 	term_charge_current = max_charge_current / 10.f;
 
+#if defined(CONFIG_FUEL_GAUGE_PERSIST)
+	parameters.state = fuel_gauge_state_restore(parameters.v0);
+#endif
+
 	nrf_fuel_gauge_init(&parameters, NULL);
 	ref_time = k_uptime_get();
 
 	return 0;
 }
 
-int fuel_gauge_update(const struct device *charger, bool vbus_connected)
+static int fuel_gauge_update(const struct device *charger, bool vbus_connected)
 {
+	struct battery_data update;
+
+	k_mutex_lock(&charger_lock, K_FOREVER);
+
 	if (sensor_sample_fetch(charger) < 0) {
+		k_mutex_unlock(&charger_lock);
 		LOG_ERR("Error: Could not fetch sensor samples");
 		return -EIO;
 	}
 
-	batt_data.voltage = get_sensor_value(charger, SENSOR_CHAN_GAUGE_VOLTAGE);
-	batt_data.temp = get_sensor_value(charger, SENSOR_CHAN_GAUGE_TEMP);
-	batt_data.current = get_sensor_value(charger, SENSOR_CHAN_GAUGE_AVG_CURRENT);
+	update.voltage = get_sensor_value(charger, SENSOR_CHAN_GAUGE_VOLTAGE);
+	update.temp = get_sensor_value(charger, SENSOR_CHAN_GAUGE_TEMP);
+	update.current = get_sensor_value(charger, SENSOR_CHAN_GAUGE_AVG_CURRENT);
 
 	int32_t chg_status = (int32_t)get_sensor_value(charger, SENSOR_CHAN_NPM1300_CHARGER_STATUS);
+
+	k_mutex_unlock(&charger_lock);
 	bool cc_charging = (chg_status & NPM1300_CHG_STATUS_CC_MASK) != 0;
 
 	float delta = (float)k_uptime_delta(&ref_time) / 1000.f;
-	batt_data.soc = nrf_fuel_gauge_process(batt_data.voltage, batt_data.current, batt_data.temp, delta, vbus_connected, NULL);
-	batt_data.tte = nrf_fuel_gauge_tte_get();
-	batt_data.ttf = nrf_fuel_gauge_ttf_get(cc_charging, -term_charge_current);
+	update.soc = nrf_fuel_gauge_process(update.voltage, update.current, update.temp, delta,
+					    vbus_connected, NULL);
+	update.tte = nrf_fuel_gauge_tte_get();
+	update.ttf = nrf_fuel_gauge_ttf_get(cc_charging, -term_charge_current);
+	update.timestamp = ref_time;
+
+	k_mutex_lock(&fuel_gauge_lock, K_FOREVER);
+	batt_data = update;
+	k_mutex_unlock(&fuel_gauge_lock);
+
+	IF_ENABLED(CONFIG_FUEL_GAUGE_PERSIST, (fuel_gauge_state_save(update.voltage);));
+	IF_ENABLED(CONFIG_SUPERCAP_MODEL, (supercap_update(&update);));
+	IF_ENABLED(CONFIG_HARVEST_TRACKER, (harvest_update(&update, vbus_connected);));
+	IF_ENABLED(CONFIG_ADMISSION_CONTROL, (admission_voltage_update(update.voltage);));
 
 	LOG_DBG("V: %.2f, I: %.2f, SoC: %.2f, TTE: %.0f, TTF: %.0f",
-		(double)batt_data.voltage, (double)batt_data.current, (double)batt_data.soc, (double)batt_data.tte, (double)batt_data.ttf);
+		(double)update.voltage, (double)update.current, (double)update.soc,
+		(double)update.tte, (double)update.ttf);
 
 	return 0;
 }
 
-void get_battery_data(struct battery_data *data)
+/* The gauge integrates current over time, so it is fed at a fixed cadence
+ * from the system work queue rather than whenever a consumer needs a value.
+ */
+static void fuel_gauge_work_handler(struct k_work *work)
 {
 	fuel_gauge_update(charger, vbus_connected);
-    *data = batt_data;
+
+	k_work_schedule(&fuel_gauge_work, K_SECONDS(CONFIG_FUEL_GAUGE_UPDATE_INTERVAL_SECONDS));
+}
+
+/* Returns the snapshot from the last gauge update, without touching the PMIC */
+void get_battery_data(struct battery_data *data)
+{
+	k_mutex_lock(&fuel_gauge_lock, K_FOREVER);
+	*data = batt_data;
+	k_mutex_unlock(&fuel_gauge_lock);
+}
+
+bool fuel_gauge_vbus_connected(void)
+{
+	return vbus_connected;
+}
+
+/* Takes a fresh voltage/current reading from the charger for energy
+ * accounting. The gauge itself is not fed, it keeps its fixed cadence.
+ */
+int fuel_gauge_power_sample(float *voltage, float *current)
+{
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&charger_lock, K_FOREVER);
+
+	if (sensor_sample_fetch(charger) < 0) {
+		k_mutex_unlock(&charger_lock);
+		return -EIO;
+	}
+
+	*voltage = get_sensor_value(charger, SENSOR_CHAN_GAUGE_VOLTAGE);
+	*current = get_sensor_value(charger, SENSOR_CHAN_GAUGE_AVG_CURRENT);
+
+	k_mutex_unlock(&charger_lock);
+
+	return 0;
+}
+
+void turn_off_regulators(void)
+{
+#if defined(CONFIG_POWER_DOMAIN_MANAGER)
+	power_domain_off_all();
+#else
+	buck2_restore = regulator_is_enabled(buck2);
+	if (buck2_restore) {
+		regulator_disable(buck2);
+	}
+#endif
+}
+
+void turn_on_regulators(void)
+{
+#if defined(CONFIG_POWER_DOMAIN_MANAGER)
+	power_domain_restore_all();
+#else
+	if (buck2_restore) {
+		regulator_enable(buck2);
+		buck2_restore = false;
+	}
+#endif
 }
 
 /**@brief Initialize nPM1300 fuel gauge. */
@@ -169,6 +275,11 @@ int npm1300_fuel_gauge_init(void)
 	}
 
 	vbus_connected = (val.val1 != 0) || (val.val2 != 0);
+
+	/* First update right away so consumers never see an empty snapshot */
+	fuel_gauge_update(charger, vbus_connected);
+	k_work_schedule(&fuel_gauge_work, K_SECONDS(CONFIG_FUEL_GAUGE_UPDATE_INTERVAL_SECONDS));
+
 	initialized = true;
 	LOG_DBG("PMIC device init successful\n");
 
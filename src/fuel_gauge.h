@@ -14,11 +14,21 @@ struct battery_data {
     float soc;
     float tte;
     float ttf;
+    int64_t timestamp;  /* Uptime of the gauge update, in ms */
 };
 
 int npm1300_fuel_gauge_init(void);
 void get_battery_data(struct battery_data *data);
-int set_3v3_power_gate(bool state);
+int fuel_gauge_power_sample(float *voltage, float *current);
+bool fuel_gauge_vbus_connected(void);
 void turn_off_regulators(void);
+/* Undoes turn_off_regulators() when the power down did not happen */
+void turn_on_regulators(void);
+
+/* Fuel gauge state checkpointing, see fuel_gauge_state.c */
+const void *fuel_gauge_state_restore(float v0);
+void fuel_gauge_state_save(float voltage);
+/* Writes the latest checkpoint to flash now, e.g. before a power down */
+void fuel_gauge_state_flush(void);
 
 #endif /* __FUEL_GAUGE_H__ */
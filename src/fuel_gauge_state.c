@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Checkpoints the nRF Fuel Gauge state so a reset or brownout does not force
+ * the SoC estimate to re-converge from a single voltage sample.
+ *
+ * The state is copied to a no-init RAM region after every gauge update, which
+ * survives warm resets (watchdog, software, pin reset), and written to the
+ * settings partition every CONFIG_FUEL_GAUGE_CHECKPOINT_INTERVAL_SECONDS,
+ * which survives a brownout. At boot the retained copy is preferred when it
+ * is valid, the flash copy is used otherwise.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(fuel_gauge_state, LOG_LEVEL_DBG);
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+#include <date_time.h>
+#include "nrf_fuel_gauge.h"
+#include "fuel_gauge.h"
+
+#define CHECKPOINT_MAGIC   0x46474331 /* "FGC1" */
+#define SETTINGS_SUBTREE   "fuel_gauge"
+#define SETTINGS_KEY       SETTINGS_SUBTREE "/state"
+#define RESTORE_MAX_AGE_MS ((int64_t)CONFIG_FUEL_GAUGE_RESTORE_MAX_AGE_SECONDS * MSEC_PER_SEC)
+
+struct fuel_gauge_checkpoint {
+	uint32_t magic;
+	uint32_t crc;
+	/* Everything below is covered by crc */
+	uint32_t state_size;
+	float voltage;
+	int64_t epoch_ms;
+	uint8_t state[CONFIG_FUEL_GAUGE_STATE_MAX_SIZE];
+};
+
+#define CHECKPOINT_CRC_START offsetof(struct fuel_gauge_checkpoint, state_size)
+#define CHECKPOINT_HDR_SIZE  offsetof(struct fuel_gauge_checkpoint, state)
+
+static __noinit struct fuel_gauge_checkpoint retained_checkpoint;
+static struct fuel_gauge_checkpoint flash_checkpoint;
+/* Uptime of the last flash write, the first one happens one interval after boot */
+static int64_t last_flash_write;
+
+static size_t checkpoint_size(const struct fuel_gauge_checkpoint *cp)
+{
+	return CHECKPOINT_HDR_SIZE + cp->state_size;
+}
+
+static uint32_t checkpoint_crc(const struct fuel_gauge_checkpoint *cp)
+{
+	return crc32_ieee((const uint8_t *)cp + CHECKPOINT_CRC_START,
+			  checkpoint_size(cp) - CHECKPOINT_CRC_START);
+}
+
+static bool checkpoint_is_valid(const struct fuel_gauge_checkpoint *cp, float v0)
+{
+	int64_t now_ms;
+
+	if (cp->magic != CHECKPOINT_MAGIC || cp->state_size != nrf_fuel_gauge_state_size ||
+	    cp->state_size > sizeof(cp->state) || cp->crc != checkpoint_crc(cp)) {
+		return false;
+	}
+
+	/* A supercapacitor's voltage follows its charge closely, so a large
+	 * voltage change means the device was off long enough (or harvested
+	 * enough) for the saved state to no longer describe it.
+	 */
+	if (fabsf(v0 - cp->voltage) * 1000.f > CONFIG_FUEL_GAUGE_RESTORE_MAX_DELTA_MV) {
+		LOG_INF("Saved gauge state is stale: %.3f V then, %.3f V now",
+			(double)cp->voltage, (double)v0);
+		return false;
+	}
+
+	if (cp->epoch_ms && date_time_now(&now_ms) == 0 &&
+	    now_ms - cp->epoch_ms > RESTORE_MAX_AGE_MS) {
+		LOG_INF("Saved gauge state is too old");
+		return false;
+	}
+
+	return true;
+}
+
+static int fuel_gauge_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+				   void *cb_arg)
+{
+	ssize_t ret;
+
+	if (strcmp(key, "state") != 0) {
+		return -ENOENT;
+	}
+
+	if (len < CHECKPOINT_HDR_SIZE || len > sizeof(flash_checkpoint)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &flash_checkpoint, len);
+	if (ret < 0) {
+		return (int)ret;
+	}
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(fuel_gauge, SETTINGS_SUBTREE, NULL, fuel_gauge_settings_set,
+			       NULL, NULL);
+
+const void *fuel_gauge_state_restore(float v0)
+{
+	int err;
+
+	if (checkpoint_is_valid(&retained_checkpoint, v0)) {
+		LOG_INF("Restoring fuel gauge state from retained RAM");
+		return retained_checkpoint.state;
+	}
+
+	err = settings_subsys_init();
+	if (!err) {
+		err = settings_load_subtree(SETTINGS_SUBTREE);
+	}
+	if (err) {
+		LOG_WRN("Unable to load saved fuel gauge state: %d", err);
+		return NULL;
+	}
+
+	if (checkpoint_is_valid(&flash_checkpoint, v0)) {
+		LOG_INF("Restoring fuel gauge state from flash");
+		return flash_checkpoint.state;
+	}
+
+	LOG_INF("No usable fuel gauge state, starting from the current reading");
+
+	return NULL;
+}
+
+void fuel_gauge_state_save(float voltage)
+{
+	struct fuel_gauge_checkpoint *cp = &retained_checkpoint;
+	int64_t interval_ms = (int64_t)CONFIG_FUEL_GAUGE_CHECKPOINT_INTERVAL_SECONDS * MSEC_PER_SEC;
+	int err;
+
+	if (nrf_fuel_gauge_state_size > sizeof(cp->state)) {
+		LOG_ERR("Fuel gauge state (%u bytes) exceeds checkpoint size",
+			nrf_fuel_gauge_state_size);
+		return;
+	}
+
+	err = nrf_fuel_gauge_state_get(cp->state, nrf_fuel_gauge_state_size);
+	if (err) {
+		LOG_ERR("Unable to get fuel gauge state: %d", err);
+		return;
+	}
+
+	cp->state_size = nrf_fuel_gauge_state_size;
+	cp->voltage = voltage;
+	if (date_time_now(&cp->epoch_ms)) {
+		cp->epoch_ms = 0;
+	}
+	cp->crc = checkpoint_crc(cp);
+	cp->magic = CHECKPOINT_MAGIC;
+
+	if (k_uptime_get() - last_flash_write < interval_ms) {
+		return;
+	}
+
+	fuel_gauge_state_flush();
+}
+
+void fuel_gauge_state_flush(void)
+{
+	struct fuel_gauge_checkpoint *cp = &retained_checkpoint;
+	int err;
+
+	if (cp->magic != CHECKPOINT_MAGIC) {
+		return;
+	}
+
+	err = settings_save_one(SETTINGS_KEY, cp, checkpoint_size(cp));
+	if (err) {
+		LOG_ERR("Unable to save fuel gauge state: %d", err);
+		return;
+	}
+
+	last_flash_write = k_uptime_get();
+}
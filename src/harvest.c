@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(harvest, LOG_LEVEL_DBG);
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/util.h>
+#include <date_time.h>
+#include "harvest.h"
+
+#define MS_PER_HOUR        ((int64_t)MSEC_PER_SEC * 3600)
+#define HARVEST_ALPHA      ((float)CONFIG_HARVEST_EWMA_PCT / 100.f)
+#define SETTINGS_SUBTREE   "harvest"
+#define SETTINGS_KEY       SETTINGS_SUBTREE "/profile"
+
+/* Readings collected over the hour in progress */
+struct harvest_accumulator {
+	int64_t epoch_hour;	/* Hours since the Unix epoch, 0 when not started */
+	int64_t start;		/* Uptime when the hour started being recorded */
+	float sum_ma;
+	uint32_t samples;
+	bool vbus_on;
+	int64_t vbus_since;	/* Uptime of the last VBUS state change */
+	int64_t vbus_ms;
+};
+
+static struct k_spinlock lock;
+static struct harvest_bin profile[HARVEST_HOURS];
+static struct harvest_accumulator acc;
+
+static void vbus_account(int64_t now)
+{
+	if (acc.vbus_on) {
+		acc.vbus_ms += now - acc.vbus_since;
+	}
+	acc.vbus_since = now;
+}
+
+/* Returns true when the hour folded was the last one of the UTC day */
+static bool fold_hour(int64_t now)
+{
+	struct harvest_bin *bin = &profile[acc.epoch_hour % HARVEST_HOURS];
+	int64_t elapsed = now - acc.start;
+	float mean_ma;
+	float vbus_pct;
+
+	vbus_account(now);
+
+	if (acc.samples == 0 || elapsed <= 0) {
+		return false;
+	}
+
+	mean_ma = acc.sum_ma / acc.samples;
+	vbus_pct = MIN(100.f, 100.f * (float)acc.vbus_ms / (float)elapsed);
+
+	if (bin->days == 0) {
+		bin->current_ma_x10 = (uint16_t)MIN(mean_ma * 10.f, (float)UINT16_MAX);
+		bin->vbus_pct = (uint8_t)vbus_pct;
+	} else {
+		bin->current_ma_x10 = (uint16_t)MIN(HARVEST_ALPHA * mean_ma * 10.f +
+						    (1.f - HARVEST_ALPHA) * bin->current_ma_x10,
+						    (float)UINT16_MAX);
+		bin->vbus_pct = (uint8_t)(HARVEST_ALPHA * vbus_pct +
+					  (1.f - HARVEST_ALPHA) * bin->vbus_pct);
+	}
+	bin->days = MIN(bin->days + 1, UINT8_MAX);
+
+	LOG_DBG("Hour %lld UTC: %.1f mA, VBUS %.0f%%", acc.epoch_hour % HARVEST_HOURS,
+		(double)mean_ma, (double)vbus_pct);
+
+	return (acc.epoch_hour % HARVEST_HOURS) == HARVEST_HOURS - 1;
+}
+
+static void start_hour(int64_t epoch_hour, int64_t now)
+{
+	bool vbus_on = acc.vbus_on;
+
+	memset(&acc, 0, sizeof(acc));
+	acc.epoch_hour = epoch_hour;
+	acc.start = now;
+	acc.vbus_on = vbus_on;
+	acc.vbus_since = now;
+}
+
+static void profile_save(void)
+{
+#if defined(CONFIG_SETTINGS)
+	struct harvest_bin copy[HARVEST_HOURS];
+	int err;
+
+	harvest_profile_get(copy);
+
+	err = settings_save_one(SETTINGS_KEY, copy, sizeof(copy));
+	if (err) {
+		LOG_ERR("Unable to save harvest profile: %d", err);
+	}
+#endif
+}
+
+void harvest_update(const struct battery_data *batt, bool vbus_connected)
+{
+	int64_t now = k_uptime_get();
+	bool day_done = false;
+	int64_t epoch_ms;
+	int64_t epoch_hour;
+
+	/* Bins are wall-clock hours, nothing can be recorded before network time */
+	if (date_time_now(&epoch_ms)) {
+		return;
+	}
+	epoch_hour = epoch_ms / MS_PER_HOUR;
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (acc.epoch_hour != epoch_hour) {
+		if (acc.epoch_hour != 0) {
+			day_done = fold_hour(now);
+		}
+		start_hour(epoch_hour, now);
+	}
+
+	if (vbus_connected != acc.vbus_on) {
+		vbus_account(now);
+		acc.vbus_on = vbus_connected;
+	}
+
+	/* Charging current is reported as negative */
+	acc.sum_ma += (batt->current < 0.f) ? -batt->current * 1000.f : 0.f;
+	acc.samples++;
+
+	k_spin_unlock(&lock, key);
+
+	if (day_done) {
+		profile_save();
+	}
+}
+
+void harvest_suspend(struct harvest_resume *state)
+{
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	/* A partial hour is not folded, that would count as a day of its own */
+	memset(state, 0, sizeof(*state));
+	if (acc.epoch_hour != 0) {
+		vbus_account(now);
+		state->epoch_hour = acc.epoch_hour;
+		state->sum_ma = acc.sum_ma;
+		state->samples = acc.samples;
+		state->recorded_ms = (uint32_t)(now - acc.start);
+		state->vbus_ms = (uint32_t)acc.vbus_ms;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	profile_save();
+}
+
+void harvest_resume(const struct harvest_resume *state)
+{
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	memset(&acc, 0, sizeof(acc));
+	if (state->epoch_hour != 0) {
+		/* The time asleep is not part of the hour's record */
+		acc.epoch_hour = state->epoch_hour;
+		acc.start = now - state->recorded_ms;
+		acc.sum_ma = state->sum_ma;
+		acc.samples = state->samples;
+		acc.vbus_ms = state->vbus_ms;
+		acc.vbus_since = now;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void harvest_vbus_event(bool vbus_connected)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (vbus_connected != acc.vbus_on) {
+		vbus_account(k_uptime_get());
+		acc.vbus_on = vbus_connected;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void harvest_profile_get(struct harvest_bin out[HARVEST_HOURS])
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	memcpy(out, profile, sizeof(profile));
+
+	k_spin_unlock(&lock, key);
+}
+
+/* Seconds until the next hour whose predicted charge current is within
+ * CONFIG_HARVEST_HIGH_WINDOW_PCT of the daily peak: 0 while inside one, -1
+ * while the profile is not trusted yet or the time of day is unknown.
+ */
+int32_t harvest_seconds_to_window(void)
+{
+	struct harvest_bin bins[HARVEST_HOURS];
+	uint16_t peak = 0;
+	uint8_t peak_days = 0;
+	int64_t epoch_ms;
+	int64_t into_hour_ms;
+	int hour;
+
+	if (date_time_now(&epoch_ms)) {
+		return -1;
+	}
+
+	harvest_profile_get(bins);
+
+	for (int i = 0; i < HARVEST_HOURS; i++) {
+		if (bins[i].current_ma_x10 > peak) {
+			peak = bins[i].current_ma_x10;
+			peak_days = bins[i].days;
+		}
+	}
+
+	if (peak == 0 || peak_days < CONFIG_HARVEST_MIN_DAYS) {
+		return -1;
+	}
+
+	hour = (int)((epoch_ms / MS_PER_HOUR) % HARVEST_HOURS);
+	into_hour_ms = epoch_ms % MS_PER_HOUR;
+
+	for (int i = 0; i < HARVEST_HOURS; i++) {
+		const struct harvest_bin *bin = &bins[(hour + i) % HARVEST_HOURS];
+
+		if (bin->current_ma_x10 * 100 >= peak * CONFIG_HARVEST_HIGH_WINDOW_PCT) {
+			return (i == 0) ? 0 : (int32_t)((i * MS_PER_HOUR - into_hour_ms) /
+							 MSEC_PER_SEC);
+		}
+	}
+
+	return -1;
+}
+
+#if defined(CONFIG_SETTINGS)
+static int harvest_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+				void *cb_arg)
+{
+	struct harvest_bin loaded[HARVEST_HOURS];
+	ssize_t ret;
+
+	if (strcmp(key, "profile") != 0) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(loaded)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, loaded, len);
+	if (ret < 0) {
+		return (int)ret;
+	}
+
+	k_spinlock_key_t lock_key = k_spin_lock(&lock);
+
+	memcpy(profile, loaded, sizeof(profile));
+
+	k_spin_unlock(&lock, lock_key);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(harvest, SETTINGS_SUBTREE, NULL, harvest_settings_set, NULL,
+			       NULL);
+#endif /* CONFIG_SETTINGS */
+
+int harvest_init(void)
+{
+#if defined(CONFIG_SETTINGS)
+	int err;
+
+	err = settings_subsys_init();
+	if (!err) {
+		err = settings_load_subtree(SETTINGS_SUBTREE);
+	}
+	if (err) {
+		LOG_WRN("Unable to load harvest profile: %d", err);
+		return err;
+	}
+#endif
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __HARVEST_H__
+#define __HARVEST_H__
+
+/** Solar harvest tracker.
+ *
+ * Builds a diurnal harvest profile of 24 hourly (UTC) bins from the charge
+ * current reported at every fuel gauge update and from the VBUS
+ * detected/removed PMIC events. At the end of each hour the mean charge
+ * current and the share of the hour VBUS was present are folded into that
+ * hour's bin with an exponential moving average, so the profile follows the
+ * seasons. The profile is saved to the settings partition once a day.
+ *
+ * Consumers ask how long until the next predicted high-harvest window to
+ * move non-urgent radio work (see `scheduler_defer_s()`).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fuel_gauge.h"
+
+#define HARVEST_HOURS 24
+
+struct harvest_bin {
+	uint16_t current_ma_x10;	/* Mean charge current, in 0.1 mA */
+	uint8_t vbus_pct;		/* Share of the hour with VBUS present */
+	uint8_t days;			/* Hours folded into the bin, saturating */
+};
+
+/** Hour in progress carried across a hibernate, see hibernate.h */
+struct harvest_resume {
+	int64_t epoch_hour;	/* 0 when no hour was being recorded */
+	float sum_ma;
+	uint32_t samples;
+	uint32_t recorded_ms;	/* Time of the hour recorded before the suspend */
+	uint32_t vbus_ms;
+};
+
+int harvest_init(void);
+void harvest_update(const struct battery_data *batt, bool vbus_connected);
+void harvest_vbus_event(bool vbus_connected);
+void harvest_profile_get(struct harvest_bin profile[HARVEST_HOURS]);
+int32_t harvest_seconds_to_window(void);
+/* Hands over the hour in progress and saves the profile before a power
+ * down. It is folded once the wall-clock hour rolls over after the resume.
+ */
+void harvest_suspend(struct harvest_resume *state);
+void harvest_resume(const struct harvest_resume *state);
+
+#endif /* __HARVEST_H__ */
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(hibernate, LOG_LEVEL_DBG);
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/mfd/npm1300.h>
+#include <zephyr/settings/settings.h>
+#include <golioth/client.h>
+#include <modem/lte_lc.h>
+#include "app_sensors.h"
+#include "energy_ledger.h"
+#include "fuel_gauge.h"
+#include "harvest.h"
+#include "hibernate.h"
+#include "location_tracking.h"
+#include "main.h"
+#include "retained.h"
+#include "scheduler.h"
+#include "supercap.h"
+
+#define RESUME_MAGIC       0x48424e31 /* "HBN1" */
+#define SETTINGS_SUBTREE   "hibernate"
+#define SETTINGS_KEY       SETTINGS_SUBTREE "/resume"
+
+/* Poll period while waiting for queued uplinks to leave */
+#define TX_DRAIN_POLL_MS   100
+/* Longest the nPM1300 takes to cut power once hibernate is requested */
+#define POWER_DOWN_TIMEOUT_MS 1000
+
+struct hibernate_record {
+	uint32_t magic;
+	uint32_t sleep_s;
+	struct app_sensors_resume sensors;
+#if defined(CONFIG_ENERGY_SCHEDULER)
+	uint8_t tier;
+#endif
+#if defined(CONFIG_SUPERCAP_MODEL)
+	float cycle_j;
+#endif
+#if defined(CONFIG_ENERGY_LEDGER)
+	struct energy_ledger_resume ledger;
+#endif
+#if defined(CONFIG_LOCATION_TRACKING)
+	uint32_t location_next_fix_s;
+#endif
+#if defined(CONFIG_HARVEST_TRACKER)
+	struct harvest_resume harvest;
+#endif
+};
+
+static const struct device *pmic = DEVICE_DT_GET(DT_INST(0, nordic_npm1300));
+static struct hibernate_record record;
+static bool record_loaded;
+
+static int hibernate_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+				  void *cb_arg)
+{
+	ssize_t ret;
+
+	if (strcmp(key, "resume") != 0) {
+		return -ENOENT;
+	}
+
+	/* A record from a different firmware layout is not usable */
+	if (len != sizeof(record)) {
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, &record, len);
+	if (ret < 0) {
+		return (int)ret;
+	}
+
+	record_loaded = (record.magic == RESUME_MAGIC);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(hibernate, SETTINGS_SUBTREE, NULL, hibernate_settings_set, NULL,
+			       NULL);
+
+bool hibernate_resume(void)
+{
+	int64_t slept_ms;
+	int err;
+
+	err = settings_subsys_init();
+	if (!err) {
+		err = settings_load_subtree(SETTINGS_SUBTREE);
+	}
+	if (err) {
+		LOG_WRN("Unable to load resume record: %d", err);
+		return false;
+	}
+
+	if (!record_loaded) {
+		return false;
+	}
+
+	/* A record is only good for the wake it was written for */
+	settings_delete(SETTINGS_KEY);
+
+	/* The time asleep is not measured: the nPM1300 wake-up timer cannot
+	 * be read back, and network time is only known after the attach. A
+	 * wake before the timer, by VBUS or the button, is therefore counted
+	 * as the full interval; the modules clamp what is due at now, so
+	 * their jobs come early by at most sleep_s and never run in the past.
+	 */
+	slept_ms = (int64_t)record.sleep_s * MSEC_PER_SEC;
+
+	app_sensors_resume(&record.sensors, slept_ms);
+	IF_ENABLED(CONFIG_ENERGY_SCHEDULER, (scheduler_tier_restore(record.tier);));
+	IF_ENABLED(CONFIG_SUPERCAP_MODEL, (supercap_cycle_cost_set(record.cycle_j);));
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_resume(&record.ledger, slept_ms);));
+	IF_ENABLED(CONFIG_LOCATION_TRACKING,
+		   (location_tracking_resume(record.location_next_fix_s, slept_ms);));
+	IF_ENABLED(CONFIG_HARVEST_TRACKER, (harvest_resume(&record.harvest);));
+
+	LOG_INF("Resumed after %u s of hibernate", record.sleep_s);
+
+	return true;
+}
+
+/* Uplinks are sent asynchronously, give them a chance to leave the device */
+static void wait_for_tx_drain(void)
+{
+	int64_t deadline = k_uptime_get() + (int64_t)CONFIG_HIBERNATE_TX_DRAIN_TIMEOUT_MS;
+
+	while (client && golioth_client_is_connected(client) &&
+	       golioth_client_num_items_in_request_queue(client) > 0 &&
+	       k_uptime_get() < deadline) {
+		k_msleep(TX_DRAIN_POLL_MS);
+	}
+}
+
+int hibernate_enter(uint32_t sleep_s)
+{
+	int err;
+
+	/* The nPM1300 leaves hibernate right away while VBUS is present */
+	if (fuel_gauge_vbus_connected()) {
+		LOG_DBG("VBUS present, not hibernating");
+		return -EBUSY;
+	}
+
+	memset(&record, 0, sizeof(record));
+	record.magic = RESUME_MAGIC;
+	record.sleep_s = sleep_s;
+
+	app_sensors_suspend(&record.sensors);
+	IF_ENABLED(CONFIG_ENERGY_SCHEDULER, (record.tier = scheduler_tier_current();));
+#if defined(CONFIG_SUPERCAP_MODEL)
+	struct supercap_estimate estimate;
+
+	supercap_estimate_get(&estimate);
+	record.cycle_j = estimate.cycle_j;
+#endif
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_suspend(&record.ledger);));
+	IF_ENABLED(CONFIG_LOCATION_TRACKING,
+		   (record.location_next_fix_s = location_tracking_next_fix_s();));
+
+	IF_ENABLED(CONFIG_HARVEST_TRACKER, (harvest_suspend(&record.harvest);));
+	IF_ENABLED(CONFIG_FUEL_GAUGE_PERSIST, (fuel_gauge_state_flush();));
+	retained_flush();
+
+	err = settings_save_one(SETTINGS_KEY, &record, sizeof(record));
+	if (err) {
+		LOG_ERR("Unable to save resume record: %d", err);
+		return err;
+	}
+
+	wait_for_tx_drain();
+
+	LOG_INF("Hibernating for %u s", sleep_s);
+
+	/* The modem stores its network state for a faster attach on wake */
+	lte_lc_power_off();
+	turn_off_regulators();
+
+	err = mfd_npm1300_hibernate(pmic, sleep_s * MSEC_PER_SEC);
+	if (!err) {
+		/* Power goes away shortly after the PMIC accepted the request */
+		k_msleep(POWER_DOWN_TIMEOUT_MS);
+		err = -ETIMEDOUT;
+	}
+
+	/* Still running: stay up for this interval instead */
+	LOG_ERR("Unable to hibernate: %d", err);
+	settings_delete(SETTINGS_KEY);
+	turn_on_regulators();
+	lte_lc_normal();
+
+	return err;
+}
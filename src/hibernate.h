@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __HIBERNATE_H__
+#define __HIBERNATE_H__
+
+/** Planned hibernate between long sensor intervals.
+ *
+ * When the next cycle is at least `CONFIG_HIBERNATE_MIN_SECONDS` away, the
+ * nPM1300 is put in hibernate with its wake-up timer set to the interval.
+ * This removes power from the nRF91 entirely, so nothing in RAM survives.
+ * Before that, the state that must outlive the power down (send-on-change
+ * reference, scheduler tier, learned cycle cost, energy ledger, location
+ * timing) is written to the settings partition as a resume record, the
+ * retained registry, fuel gauge checkpoint and harvest profile are flushed,
+ * queued samples are moved to the flash store, and the modem is powered off
+ * so it saves its network state for a quick re-attach.
+ *
+ * At boot, `hibernate_resume()` finds the record, hands the state back to
+ * each module and deletes it, and `main()` skips the cold-boot-only steps.
+ * The modules are told the full interval has passed, also after an early
+ * wake by VBUS or the button, since the time asleep cannot be measured.
+ *
+ * If the nPM1300 does not power down, the record is deleted and the
+ * regulators, power domains and modem are switched back on.
+ *
+ * The DTLS session, including its connection ID, lives in the modem and is
+ * lost with it: every wake performs a fresh handshake.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool hibernate_resume(void);
+/* Only returns when the device could not hibernate */
+int hibernate_enter(uint32_t sleep_s);
+
+#endif /* __HIBERNATE_H__ */
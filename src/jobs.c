@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(jobs, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include "jobs.h"
+#include "radio_window.h"
+
+#define NOT_SCHEDULED INT64_MAX
+
+struct job {
+	job_fn fn;
+	int64_t due;	/* Uptime (ms) of the next run */
+};
+
+static struct job jobs[JOB_COUNT] = {
+	[0 ... JOB_COUNT - 1] = { .fn = NULL, .due = NOT_SCHEDULED },
+};
+
+static struct k_spinlock lock;
+static K_SEM_DEFINE(wake, 0, 1);
+static jobs_idle_hook_fn idle_hook;
+
+void jobs_register(enum job_id id, job_fn fn)
+{
+	jobs[id].fn = fn;
+}
+
+void jobs_set_idle_hook(jobs_idle_hook_fn hook)
+{
+	idle_hook = hook;
+}
+
+void jobs_schedule(enum job_id id, int32_t delay_s)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	jobs[id].due = k_uptime_get() + (int64_t)MAX(delay_s, 0) * MSEC_PER_SEC;
+
+	k_spin_unlock(&lock, key);
+
+	k_sem_give(&wake);
+}
+
+uint32_t jobs_next_due_s(enum job_id id)
+{
+	int64_t due;
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	due = jobs[id].due;
+
+	k_spin_unlock(&lock, key);
+
+	if (due == NOT_SCHEDULED) {
+		return UINT32_MAX;
+	}
+
+	return MAX(due - k_uptime_get(), 0) / MSEC_PER_SEC;
+}
+
+uint32_t jobs_idle_s(int32_t own_next_s)
+{
+	int64_t now = k_uptime_get();
+	int64_t idle_ms = (int64_t)MAX(own_next_s, 0) * MSEC_PER_SEC;
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	/* The running job is unscheduled until it returns */
+	for (size_t i = 0; i < JOB_COUNT; i++) {
+		if (jobs[i].fn && jobs[i].due != NOT_SCHEDULED) {
+			idle_ms = MIN(idle_ms, MAX(jobs[i].due - now, 0));
+		}
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return idle_ms / MSEC_PER_SEC;
+}
+
+/* Returns the earliest job not run yet in this batch, or JOB_COUNT */
+static enum job_id earliest_job(uint32_t ran, int64_t *due)
+{
+	enum job_id next = JOB_COUNT;
+
+	*due = NOT_SCHEDULED;
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < JOB_COUNT; i++) {
+		if (jobs[i].fn && !(ran & BIT(i)) && jobs[i].due < *due) {
+			next = i;
+			*due = jobs[i].due;
+		}
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return next;
+}
+
+static void run_job(enum job_id id)
+{
+	int32_t delay_s;
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	jobs[id].due = NOT_SCHEDULED;
+
+	k_spin_unlock(&lock, key);
+
+	delay_s = jobs[id].fn();
+
+	key = k_spin_lock(&lock);
+
+	/* Keep an earlier run requested while the job was running */
+	jobs[id].due = MIN(jobs[id].due,
+			   k_uptime_get() + (int64_t)MAX(delay_s, 0) * MSEC_PER_SEC);
+
+	k_spin_unlock(&lock, key);
+}
+
+void jobs_run(void)
+{
+	while (true) {
+		int64_t now = k_uptime_get();
+		int64_t due;
+
+		earliest_job(0, &due);
+
+		if (due == NOT_SCHEDULED) {
+			k_sem_take(&wake, K_FOREVER);
+			continue;
+		}
+
+		if (due > now) {
+			int64_t idle_ms = due - now;
+
+			if (idle_hook && idle_ms >= MSEC_PER_SEC) {
+				idle_hook(idle_ms / MSEC_PER_SEC);
+			}
+
+			k_sem_take(&wake, K_MSEC(MAX(due - k_uptime_get(), 0)));
+			continue;
+		}
+
+		/* Everything due soon runs now and shares the radio window */
+		int64_t window_end = now + (int64_t)CONFIG_JOBS_COALESCE_SECONDS * MSEC_PER_SEC;
+		uint32_t ran = 0;
+		enum job_id id;
+
+		while ((id = earliest_job(ran, &due)) != JOB_COUNT && due <= window_end) {
+			ran |= BIT(id);
+			run_job(id);
+		}
+
+		/* The radio work the jobs asked for goes out together */
+		radio_window_run(jobs_idle_s(INT32_MAX));
+	}
+}
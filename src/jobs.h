@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __JOBS_H__
+#define __JOBS_H__
+
+/** Application job timeline.
+ *
+ * All periodic application work runs as jobs on the main thread, driven by
+ * `jobs_run()`, instead of on threads of its own. A job function does its
+ * work and returns the number of seconds until it should run again.
+ *
+ * Jobs that fall due within `CONFIG_JOBS_COALESCE_SECONDS` of each other run
+ * back to back. Jobs leave their radio work to the shared radio window (see
+ * radio_window.h), which runs once after each batch and then releases the
+ * connection with `jobs_idle_s()`, the time until the next job.
+ *
+ * Between jobs the thread blocks until the next one is due, or until
+ * `jobs_schedule()` moves a job forward. Before blocking, the idle hook is
+ * given the idle time, e.g. to hibernate.
+ */
+
+#include <stdint.h>
+
+enum job_id {
+	JOB_SENSORS,
+	JOB_LOCATION,
+	JOB_COUNT,
+};
+
+/* Returns the delay until the next run in seconds */
+typedef int32_t (*job_fn)(void);
+/* Only returns when the device did not power down */
+typedef void (*jobs_idle_hook_fn)(uint32_t idle_s);
+
+void jobs_register(enum job_id id, job_fn fn);
+/* (Re)schedules a job delay_s from now; callable from any context */
+void jobs_schedule(enum job_id id, int32_t delay_s);
+/* Seconds until the job runs, or UINT32_MAX when it is not scheduled */
+uint32_t jobs_next_due_s(enum job_id id);
+/* Time until any job runs, or until own_next_s when that is sooner */
+uint32_t jobs_idle_s(int32_t own_next_s);
+void jobs_set_idle_hook(jobs_idle_hook_fn hook);
+/* Never returns */
+void jobs_run(void);
+
+#endif /* __JOBS_H__ */
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(location_cache, LOG_LEVEL_DBG);
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <date_time.h>
+#include "location_cache.h"
+
+#define CACHE_MAGIC        0x4c434331 /* "LCC1" */
+#define SETTINGS_SUBTREE   "loccache"
+#define SETTINGS_KEY       SETTINGS_SUBTREE "/entry"
+
+struct cache_entry {
+	uint32_t magic;
+	int64_t stored_at_s;	/* UTC, 0 when the time was unknown */
+	struct cell_fingerprint fp;
+	struct golioth_location_rsp rsp;
+};
+
+static struct cache_entry entry;
+static bool entry_valid;
+
+static int location_cache_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+				       void *cb_arg)
+{
+	ssize_t ret;
+
+	if (strcmp(key, "entry") != 0) {
+		return -ENOENT;
+	}
+
+	/* An entry from a different firmware layout is not usable */
+	if (len != sizeof(entry)) {
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, &entry, len);
+	if (ret < 0) {
+		return (int)ret;
+	}
+
+	entry_valid = (entry.magic == CACHE_MAGIC);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(location_cache, SETTINGS_SUBTREE, NULL,
+			       location_cache_settings_set, NULL, NULL);
+
+static int64_t utc_now_s(void)
+{
+	int64_t now_ms;
+
+	if (date_time_now(&now_ms)) {
+		return 0;
+	}
+
+	return now_ms / MSEC_PER_SEC;
+}
+
+static bool cell_in(const struct cell_fingerprint *fp, uint32_t cell)
+{
+	for (size_t i = 0; i < fp->count; i++) {
+		if (fp->cells[i] == cell) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Jaccard index of the two cell sets, in percent */
+static uint32_t similarity_pct(const struct cell_fingerprint *a,
+			       const struct cell_fingerprint *b)
+{
+	uint32_t common = 0;
+	uint32_t total;
+
+	for (size_t i = 0; i < a->count; i++) {
+		if (cell_in(b, a->cells[i])) {
+			common++;
+		}
+	}
+
+	total = a->count + b->count - common;
+	if (total == 0) {
+		return 0;
+	}
+
+	return common * 100 / total;
+}
+
+static bool entry_expired(void)
+{
+	int64_t now_s;
+
+	if (CONFIG_LOCATION_CACHE_MAX_AGE_SECONDS == 0 || entry.stored_at_s == 0) {
+		return false;
+	}
+
+	now_s = utc_now_s();
+
+	return now_s != 0 &&
+	       (now_s - entry.stored_at_s) >= CONFIG_LOCATION_CACHE_MAX_AGE_SECONDS;
+}
+
+bool location_cache_lookup(const struct cell_fingerprint *fp, struct golioth_location_rsp *rsp)
+{
+	uint32_t score;
+
+	if (!entry_valid) {
+		return false;
+	}
+
+	if (fp->mcc != entry.fp.mcc || fp->mnc != entry.fp.mnc || fp->tac != entry.fp.tac) {
+		LOG_DBG("Tracking area changed");
+		return false;
+	}
+
+	score = similarity_pct(fp, &entry.fp);
+	if (score < CONFIG_LOCATION_CACHE_SIMILARITY_PCT) {
+		LOG_DBG("Cells changed, similarity %u%%", score);
+		return false;
+	}
+
+	if (entry_expired()) {
+		LOG_DBG("Cached location too old");
+		return false;
+	}
+
+	LOG_INF("Location unchanged (similarity %u%%)", score);
+	*rsp = entry.rsp;
+
+	return true;
+}
+
+void location_cache_store(const struct cell_fingerprint *fp,
+			  const struct golioth_location_rsp *rsp)
+{
+	int err;
+
+	entry.magic = CACHE_MAGIC;
+	entry.stored_at_s = utc_now_s();
+	entry.fp = *fp;
+	entry.rsp = *rsp;
+	entry_valid = true;
+
+	err = settings_save_one(SETTINGS_KEY, &entry, sizeof(entry));
+	if (err) {
+		LOG_WRN("Unable to save cached location: %d", err);
+	}
+}
+
+int location_cache_init(void)
+{
+	int err;
+
+	err = settings_subsys_init();
+	if (!err) {
+		err = settings_load_subtree(SETTINGS_SUBTREE);
+	}
+	if (err) {
+		LOG_WRN("Unable to load cached location: %d", err);
+		return err;
+	}
+
+	if (entry_valid) {
+		LOG_INF("Cached location for cell %u", entry.fp.cell_id);
+	}
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __LOCATION_CACHE_H__
+#define __LOCATION_CACHE_H__
+
+/** Cell fingerprint cache for location fixes.
+ *
+ * Most devices never move, so a new cellular location request would
+ * usually return the same position as the last one. The last Golioth
+ * response is kept together with the cell fingerprint it was computed
+ * from: the PLMN, the tracking area, the serving cell and the EARFCN/PCI
+ * of every cell measured.
+ *
+ * A new fingerprint matches when the PLMN and the tracking area are the
+ * same and the cell sets overlap by at least
+ * `CONFIG_LOCATION_CACHE_SIMILARITY_PCT` (Jaccard index). The cached
+ * response is then reused, with no round trip. An entry older than
+ * `CONFIG_LOCATION_CACHE_MAX_AGE_SECONDS` is refreshed even when it
+ * matches. The entry is kept in the settings partition, so it survives
+ * resets and hibernate.
+ */
+
+#include <stdbool.h>
+#include <golioth/location/cellular.h>
+#include "location_tracking.h"
+
+int location_cache_init(void);
+/* Returns true and fills rsp when fp matches the cached fingerprint */
+bool location_cache_lookup(const struct cell_fingerprint *fp, struct golioth_location_rsp *rsp);
+void location_cache_store(const struct cell_fingerprint *fp,
+			  const struct golioth_location_rsp *rsp);
+
+#endif /* __LOCATION_CACHE_H__ */
@@ -13,17 +13,41 @@
 #include <samples/common/net_connect.h>
 #include "location_tracking.h"
 #include "main.h"
+#include "energy_ledger.h"
+#include "scheduler.h"
+#include "admission.h"
+#include "jobs.h"
+#include "radio_window.h"
+#include "location_cache.h"
+#include "motion.h"
 
 #if defined(CONFIG_LOCATION_TRACKING)
 LOG_MODULE_REGISTER(location_tracking, LOG_LEVEL_DBG);
 
-/* Timer used to time the location sampling rate. */
-static K_TIMER_DEFINE(location_sample_timer, NULL, NULL);
+/* The first fix after a cold boot */
+#define FIRST_FIX_DELAY_S 30
 
-#define APP_TIMEOUT_S 10
+/* Set on a resume from hibernate so the interval spans the power down */
+static int64_t resume_delay_ms;
 
 static struct golioth_location_req location_req;
 
+#if defined(CONFIG_LOCATION_MOTION_GATING)
+/* The interrupt is armed, fixes follow motion instead of the interval */
+static bool motion_gated;
+static int64_t last_fix_ms;
+#endif
+
+/* location_req holds a measurement that still has to be sent */
+static bool request_pending;
+static uint8_t request_retries;
+
+#if defined(CONFIG_LOCATION_CACHE)
+/* Cells of the last measurement, stored with the response */
+static struct cell_fingerprint fingerprint;
+static bool have_fingerprint;
+#endif
+
 static int cellular_get_and_encode_info(void)
 {
     struct golioth_cellular_info cellular_infos[4];
@@ -37,7 +61,9 @@ static int cellular_get_and_encode_info(void)
         return 0;
     }
 
+    IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_begin(ENERGY_LEDGER_OP_CELL_MEAS);));
     err = cellular_info_get(cellular_infos, ARRAY_SIZE(cellular_infos), &num_infos);
+    IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_end(ENERGY_LEDGER_OP_CELL_MEAS);));
     if (err)
     {
         LOG_ERR("Failed to get cellular network info: %d", err);
@@ -57,57 +83,247 @@ static int cellular_get_and_encode_info(void)
     return 0;
 }
 
-void location_tracking_thread_fn(void)
+uint32_t location_tracking_next_fix_s(void)
+{
+    return jobs_next_due_s(JOB_LOCATION);
+}
+
+void location_tracking_resume(uint32_t next_fix_s, int64_t slept_ms)
+{
+    resume_delay_ms = MAX((int64_t)next_fix_s * MSEC_PER_SEC - slept_ms, 0);
+}
+
+/* Time until the next regular fix */
+static int32_t fix_interval_s(void)
+{
+#if defined(CONFIG_LOCATION_MOTION_GATING)
+    if (motion_gated)
+    {
+        /* Stationary heartbeat, motion brings the next fix forward */
+        return CONFIG_LOCATION_MOTION_HEARTBEAT_SECONDS;
+    }
+#endif
+
+    return CONFIG_LOCATION_TRACKING_SAMPLE_INTERVAL_SECONDS;
+}
+
+#if defined(CONFIG_LOCATION_MOTION_GATING)
+static void location_motion_handler(void)
+{
+    int64_t since_ms = k_uptime_get() - last_fix_ms;
+    uint32_t delay_s = 0;
+
+    /* At most one fix per hold-off while the device keeps moving */
+    if (since_ms < CONFIG_LOCATION_MOTION_HOLDOFF_SECONDS * MSEC_PER_SEC)
+    {
+        delay_s = CONFIG_LOCATION_MOTION_HOLDOFF_SECONDS - since_ms / MSEC_PER_SEC;
+    }
+
+    if (delay_s < jobs_next_due_s(JOB_LOCATION))
+    {
+        LOG_INF("Motion, location fix in %u s", delay_s);
+        jobs_schedule(JOB_LOCATION, delay_s);
+    }
+}
+#endif
+
+/* Runs before the connection is set up in the radio window */
+static void location_cell_meas(bool online)
 {
     struct golioth_location_rsp location_rsp;
     enum golioth_status status;
     int err;
 
-	LOG_INF("Location tracking module has started");
+    ARG_UNUSED(online);
 
-	/* Begin location tracker */
-	while (true) {
-		k_timer_start(&location_sample_timer,
-			K_SECONDS(CONFIG_LOCATION_TRACKING_SAMPLE_INTERVAL_SECONDS), K_FOREVER);
+    golioth_location_init(&location_req);
 
-        golioth_location_init(&location_req);
+    err = cellular_get_and_encode_info();
+    if (err)
+    {
+        LOG_ERR("cellular_get_and_encode_info() err");
+        return;
+    }
 
-        err = cellular_get_and_encode_info();
-        if (err)
+    status = golioth_location_finish(&location_req);
+    if (status != GOLIOTH_OK)
+    {
+        if (status == GOLIOTH_ERR_NULL)
         {
-            LOG_ERR("cellular_get_and_encode_info() err");
-            continue;
+            LOG_WRN("No location data to be provided");
         }
-
-        status = golioth_location_finish(&location_req);
-        if (status != GOLIOTH_OK)
+        else
         {
-            LOG_ERR("Failed golioth_location_finish");
-            if (status == GOLIOTH_ERR_NULL)
-            {
-                LOG_WRN("No location data to be provided");
-                return;
-            }
-
             LOG_ERR("Failed to encode location data");
-            return;
         }
+        return;
+    }
+
+#if defined(CONFIG_LOCATION_CACHE)
+    /* A device that has not moved sees the same cells */
+    have_fingerprint = (cellular_fingerprint_get(&fingerprint) == 0);
+
+    if (have_fingerprint && location_cache_lookup(&fingerprint, &location_rsp))
+    {
+        return;
+    }
+#else
+    ARG_UNUSED(location_rsp);
+#endif
+
+#if defined(CONFIG_ADMISSION_CONTROL)
+    if (admission_check(ENERGY_LEDGER_OP_LOCATION, 1) != ADMISSION_ADMIT)
+    {
+        LOG_INF("Location request dropped, not enough energy");
+        return;
+    }
+#endif
+
+    /* Joins the window that is running */
+    request_pending = true;
+    request_retries = 0;
+    radio_window_request(RADIO_INTENT_LOCATION);
+}
+
+/* Sends the same measurement again after a backoff, within the budget */
+static void location_request_retry(void)
+{
+    uint32_t delay_s;
+
+    if (request_retries >= CONFIG_LOCATION_TRACKING_RETRY_MAX)
+    {
+        LOG_WRN("Location request failed %u times, waiting for the next interval",
+                request_retries);
+        request_pending = false;
+        return;
+    }
+
+    delay_s = MIN(CONFIG_LOCATION_TRACKING_RETRY_MIN_SECONDS << request_retries,
+                  CONFIG_LOCATION_TRACKING_SAMPLE_INTERVAL_SECONDS);
+    request_retries++;
+
+    /* Never later than the regular fix */
+    if (delay_s < jobs_next_due_s(JOB_LOCATION))
+    {
+        LOG_INF("Retrying location request in %u s", delay_s);
+        jobs_schedule(JOB_LOCATION, delay_s);
+    }
+}
+
+static void location_request(bool online)
+{
+    struct golioth_location_rsp location_rsp;
+    enum golioth_status status;
+
+    if (!online)
+    {
+        LOG_INF("Location request deferred, offline");
+        location_request_retry();
+        return;
+    }
 
-        status = golioth_location_get_sync(client, &location_req, &location_rsp, APP_TIMEOUT_S);
-        if (status == GOLIOTH_OK)
+    /* Bounded, and only ever run with the connection up */
+    IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_begin(ENERGY_LEDGER_OP_LOCATION);));
+    status = golioth_location_get_sync(client, &location_req, &location_rsp,
+                                       CONFIG_LOCATION_TRACKING_TIMEOUT_SECONDS);
+    IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_end(ENERGY_LEDGER_OP_LOCATION);));
+    if (status != GOLIOTH_OK)
+    {
+        LOG_ERR("Location request failed: %d", status);
+        location_request_retry();
+        return;
+    }
+
+    request_pending = false;
+
+    LOG_INF("%s%lld.%09lld %s%lld.%09lld (%lld)",
+            location_rsp.latitude < 0 ? "-" : "",
+            llabs(location_rsp.latitude) / 1000000000,
+            llabs(location_rsp.latitude) % 1000000000,
+            location_rsp.longitude < 0 ? "-" : "",
+            llabs(location_rsp.longitude) / 1000000000,
+            llabs(location_rsp.longitude) % 1000000000,
+            (long long int) location_rsp.accuracy);
+
+#if defined(CONFIG_LOCATION_CACHE)
+    if (have_fingerprint)
+    {
+        location_cache_store(&fingerprint, &location_rsp);
+    }
+#endif
+}
+
+/* One location fix, returns the delay until the next one */
+static int32_t location_tracking_job(void)
+{
+#if defined(CONFIG_ENERGY_SCHEDULER)
+    /* A fix is never urgent, take it when the panel pays for it */
+    int32_t defer_s = scheduler_defer_s();
+
+    if (defer_s > 0)
+    {
+        LOG_INF("Deferring location fix by %d s to the harvest window", defer_s);
+        return defer_s;
+    }
+#endif
+
+#if defined(CONFIG_LOCATION_MOTION_GATING)
+    last_fix_ms = k_uptime_get();
+#endif
+
+    if (request_pending)
+    {
+        /* A retry reuses the measurement that was not sent */
+#if defined(CONFIG_ADMISSION_CONTROL)
+        if (admission_check(ENERGY_LEDGER_OP_LOCATION, 1) != ADMISSION_ADMIT)
         {
-            LOG_INF("%s%lld.%09lld %s%lld.%09lld (%lld)",
-                    location_rsp.latitude < 0 ? "-" : "",
-                    llabs(location_rsp.latitude) / 1000000000,
-                    llabs(location_rsp.latitude) % 1000000000,
-                    location_rsp.longitude < 0 ? "-" : "",
-                    llabs(location_rsp.longitude) / 1000000000,
-                    llabs(location_rsp.longitude) % 1000000000,
-                    (long long int) location_rsp.accuracy);
+            LOG_INF("Location request dropped, not enough energy");
+            request_pending = false;
+            return fix_interval_s();
         }
+#endif
+        radio_window_request(RADIO_INTENT_LOCATION);
+        return fix_interval_s();
+    }
+
+#if defined(CONFIG_ADMISSION_CONTROL)
+    if (admission_check(ENERGY_LEDGER_OP_CELL_MEAS, 1) != ADMISSION_ADMIT)
+    {
+        LOG_INF("Location fix dropped, not enough energy");
+        return fix_interval_s();
+    }
+#endif
+
+    /* The measurement and the request run in the shared radio window */
+    radio_window_request(RADIO_INTENT_CELL_MEAS);
 
-		/* Wait out any remaining time on the sample interval timer. */
-		k_timer_status_sync(&location_sample_timer);
-	}
+    return fix_interval_s();
+}
+
+void location_tracking_init(void)
+{
+    LOG_INF("Location tracking module has started");
+
+    IF_ENABLED(CONFIG_LOCATION_CACHE, (location_cache_init();));
+
+    radio_window_register(RADIO_INTENT_CELL_MEAS, location_cell_meas);
+    radio_window_register(RADIO_INTENT_LOCATION, location_request);
+    jobs_register(JOB_LOCATION, location_tracking_job);
+
+#if defined(CONFIG_LOCATION_MOTION_GATING)
+    /* Without the interrupt the fix falls back to the regular interval */
+    motion_gated = (motion_init(location_motion_handler) == 0);
+#endif
+
+    if (resume_delay_ms > 0)
+    {
+        LOG_INF("Next location fix in %lld s", resume_delay_ms / MSEC_PER_SEC);
+        jobs_schedule(JOB_LOCATION, resume_delay_ms / MSEC_PER_SEC);
+    }
+    else
+    {
+        /* Leave the attach and the first uplink some room */
+        jobs_schedule(JOB_LOCATION, FIRST_FIX_DELAY_S);
+    }
 }
 #endif
@@ -7,7 +7,26 @@
 
 #include <golioth/location/cellular.h>
 
-void location_tracking_thread_fn(void);
+/* Registers the location job on the application timeline, see jobs.h */
+void location_tracking_init(void);
+
+/* Time until the next fix, carried across a hibernate */
+uint32_t location_tracking_next_fix_s(void);
+void location_tracking_resume(uint32_t next_fix_s, int64_t slept_ms);
+
+/* Cells seen by the last measurement, identified by EARFCN and PCI */
+#define CELL_FINGERPRINT_MAX_CELLS 8
+
+struct cell_fingerprint {
+    uint16_t mcc;
+    uint16_t mnc;
+    uint32_t tac;
+    uint32_t cell_id; /* Serving cell */
+    uint8_t count;
+    uint32_t cells[CELL_FINGERPRINT_MAX_CELLS];
+};
+
+int cellular_fingerprint_get(struct cell_fingerprint *fp);
 
 int cellular_info_get(struct golioth_cellular_info *infos,
                       size_t num_max_infos,
@@ -21,13 +21,60 @@ LOG_MODULE_REGISTER(solaris, LOG_LEVEL_DBG);
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
 #include <modem/lte_lc.h>
+#include <modem/nrf_modem_lib.h>
 #include <helpers/nrfx_reset_reason.h>
 #include "location_tracking.h"
+#include "retained.h"
+#include "boot_timing.h"
+#include "conn_mgr.h"
+#include "jobs.h"
+#include "radio_window.h"
+#include <zephyr/settings/settings.h>
 
 #ifdef CONFIG_NRF_FUEL_GAUGE
 #include "fuel_gauge.h"
 #endif
 
+#ifdef CONFIG_ENERGY_SCHEDULER
+#include "scheduler.h"
+#endif
+
+#ifdef CONFIG_SAMPLE_STORE
+#include "sample_store.h"
+#endif
+
+#ifdef CONFIG_SAMPLER
+#include "sampler.h"
+#endif
+
+#ifdef CONFIG_SUPERCAP_MODEL
+#include "supercap.h"
+#endif
+
+#ifdef CONFIG_ENERGY_LEDGER
+#include "energy_ledger.h"
+#endif
+
+#ifdef CONFIG_HARVEST_TRACKER
+#include "harvest.h"
+#endif
+
+#ifdef CONFIG_ADMISSION_CONTROL
+#include "admission.h"
+#endif
+
+#ifdef CONFIG_POWER_DOMAIN_MANAGER
+#include "power_domain.h"
+#endif
+
+#ifdef CONFIG_PSM_COORDINATOR
+#include "psm.h"
+#endif
+
+#ifdef CONFIG_HIBERNATE
+#include "hibernate.h"
+#endif
+
 #ifdef CONFIG_MODEM_INFO
 #include <modem/modem_info.h>
 #endif
@@ -38,15 +85,11 @@ static const char *_current_version =
 
 struct golioth_client *client;
 
-K_SEM_DEFINE(connected, 0, 1);
-
-static k_tid_t _system_thread = 0;
+/* Set when this boot is a wake from a planned hibernate */
+static bool resumed;
 
-#if defined(CONFIG_LOCATION_TRACKING)
-/* Start the cellular location thread with a delay of 30s */
-K_THREAD_DEFINE(cell_location_thread, CONFIG_LOCATION_TRACKING_THREAD_STACK_SIZE, location_tracking_thread_fn,
-		NULL, NULL, NULL, 0, 0, 30000);
-#endif
+/* Only sent on a cold boot, as soon as the first connection is up */
+static bool startup_reported;
 
 static const struct gpio_dt_spec stratus_led = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
 
@@ -55,20 +98,17 @@ static const struct gpio_dt_spec stratus_led = GPIO_DT_SPEC_GET(DT_ALIAS(led0),
 void device_connection_led_set(uint8_t state);
 #endif
 
-void wake_system_thread(void)
-{
-	k_wakeup(_system_thread);
-}
-
 static void on_client_event(struct golioth_client *client,
 							enum golioth_client_event event,
 							void *arg)
 {
 	bool is_connected = (event == GOLIOTH_CLIENT_EVENT_CONNECTED);
 
+	conn_mgr_client_event(is_connected);
+
 	if (is_connected)
 	{
-		k_sem_give(&connected);
+		boot_timing_mark(BOOT_PHASE_CONNECTED);
 
 		#if CONFIG_LED_INDICATION_ENABLED
 			device_connection_led_set(1);
@@ -99,6 +139,9 @@ static void start_golioth_client(void)
 	/* Set Golioth Client for streaming sensor data */
 	app_sensors_set_client(client);
 
+	/* Set Golioth Client for streaming energy accounting */
+	IF_ENABLED(CONFIG_ENERGY_LEDGER, (energy_ledger_set_client(client);));
+
 	/* Register Settings service */
 	app_settings_register(client);
 
@@ -115,11 +158,7 @@ static void lte_handler(const struct lte_lc_evt *const evt)
 			{
 			case LTE_LC_NW_REG_REGISTERED_ROAMING:
 			case LTE_LC_NW_REG_REGISTERED_HOME:
-				if (!client)
-				{
-					/* Create and start a Golioth Client */
-					start_golioth_client();
-				}
+				boot_timing_mark(BOOT_PHASE_LTE_REGISTERED);
 				break;
 			}
 			break;
@@ -234,25 +273,87 @@ static void print_reset_reason(void)
 	LOG_INF("Reset reason: %s (0x%x)", reset_reason_str, reset_reason);
 }
 
+static int32_t next_loop_delay_s(void)
+{
+	/* Close the energy accounting of the cycle that just ran */
+	IF_ENABLED(CONFIG_SUPERCAP_MODEL, (supercap_cycle_mark();));
+
+#if defined(CONFIG_ENERGY_SCHEDULER)
+	struct battery_data batt_data;
+
+	get_battery_data(&batt_data);
+
+	return scheduler_next_delay_s(&batt_data);
+#else
+	return get_loop_delay_s();
+#endif
+}
+
+/* One sensor cycle, returns the delay until the next one */
+static int32_t sensor_job(void)
+{
+	/* The uplink, if any, goes out in the shared radio window */
+	if (app_sensors_read() || !startup_reported)
+	{
+		radio_window_request(RADIO_INTENT_UPLINK);
+	}
+
+	return next_loop_delay_s();
+}
+
+static void sensor_uplink(bool online)
+{
+	if (online && !startup_reported)
+	{
+		startup_reported = (report_startup() == 0);
+	}
+
+	/* Samples are queued offline while the link is down */
+	app_sensors_stream();
+
+	if (online)
+	{
+		/* Only counts when no startup report was sent */
+		boot_timing_mark(BOOT_PHASE_FIRST_UPLINK);
+	}
+}
+
+#if defined(CONFIG_HIBERNATE)
+static void idle_hook(uint32_t idle_s)
+{
+	/* Does not return when the device powers down */
+	if (idle_s >= CONFIG_HIBERNATE_MIN_SECONDS)
+	{
+		hibernate_enter(idle_s);
+	}
+}
+#endif
+
 int main(void)
 {
 	int err;
 
+	boot_timing_mark(BOOT_PHASE_MAIN);
+
 	LOG_DBG("Starting sample on %s\n", CONFIG_BOARD);
 	LOG_INF("Firmware version: %s", _current_version);
-	IF_ENABLED(CONFIG_MODEM_INFO, (log_modem_firmware_version();));
-	print_reset_reason();
 
-	/* Get system thread id so loop delay change event can wake main */
-	_system_thread = k_current_get();
+	/* Counters and settings must be in place before anything uses them */
+	retained_init();
 
-	/* Initialize LED */
-	err = gpio_pin_configure_dt(&stratus_led, GPIO_OUTPUT_INACTIVE);
-	if (err)
+#if defined(CONFIG_HIBERNATE)
+	resumed = hibernate_resume();
+#endif
+
+	if (!resumed)
 	{
-		LOG_ERR("Unable to configure LED");
+		print_reset_reason();
 	}
 
+	/* Only what the attach depends on runs before it: the energy checks
+	 * need the fuel gauge, everything else is set up while the modem
+	 * searches for the network.
+	 */
 #if defined(CONFIG_NRF_FUEL_GAUGE)
 	bool fuel_gauge_initialized = npm1300_fuel_gauge_init();
 
@@ -263,16 +364,51 @@ int main(void)
 	}
 #endif
 
+	/* The attach itself is left to the connection manager, which checks
+	 * admission, meters it and sends the PSM request first.
+	 */
+	err = nrf_modem_lib_init();
+	if (err)
+	{
+		LOG_ERR("Modem library init, error: %d", err);
+		return 0;
+	}
+
+#if defined(CONFIG_ADMISSION_CONTROL)
+	err = admission_init();
+	if (err)
+	{
+		LOG_ERR("Admission control init, error: %d", err);
+	}
+#endif
+
+#if defined(CONFIG_PSM_COORDINATOR)
+	/* Before the attach, so it already carries the requested TAU */
+	err = psm_init(get_loop_delay_s());
+	if (err)
+	{
+		LOG_ERR("PSM coordinator init, error: %d", err);
+	}
+#endif
+
+	boot_timing_mark(BOOT_PHASE_POWER_READY);
+
 	/* Start LTE asynchronously if the nRF91xx is used.
-	 * Golioth Client will start automatically when LTE connects
+	 * Golioth Client is started by the connection manager once LTE registers
 	 */
+	lte_lc_register_handler(lte_handler);
+	conn_mgr_init(start_golioth_client);
 
 	LOG_INF("Connecting to LTE, this may take some time...");
-	err = lte_lc_connect_async(lte_handler);
+	err = conn_mgr_start();
 	if (err)
 	{
-		LOG_ERR("Failed to connect to LTE network, error: %d", err);
-		return -1;
+		/* Retried from the main loop */
+		LOG_WRN("LTE attach not started, error: %d", err);
+	}
+	else
+	{
+		boot_timing_mark(BOOT_PHASE_LTE_START);
 	}
 
 #if CONFIG_LTE_PSM_REQ
@@ -283,25 +419,73 @@ int main(void)
 	}
 #endif
 
-	/* Block until connected to Golioth */
-	k_sem_take(&connected, K_FOREVER);
+	/* A wake from hibernate skips what only matters after a cold boot */
+	if (resumed)
+	{
+		IF_ENABLED(CONFIG_MODEM_INFO, (modem_info_init();));
+	}
+	else
+	{
+		IF_ENABLED(CONFIG_MODEM_INFO, (log_modem_firmware_version();));
+	}
+
+	/* Golioth credentials, see CONFIG_GOLIOTH_SAMPLE_SETTINGS_AUTOLOAD */
+	err = settings_subsys_init();
+	if (!err)
+	{
+		err = settings_load_subtree("golioth");
+	}
+	if (err)
+	{
+		LOG_ERR("Unable to load credentials, error: %d", err);
+	}
 
-	report_startup();
+	/* Initialize LED */
+	err = gpio_pin_configure_dt(&stratus_led, GPIO_OUTPUT_INACTIVE);
+	if (err)
+	{
+		LOG_ERR("Unable to configure LED");
+	}
 
-	while (true)
+#if defined(CONFIG_POWER_DOMAIN_MANAGER)
+	err = power_domain_init();
+	if (err)
 	{
-		/* Check LTE connection and if Golioth client is connected */
-		if (!golioth_client_is_connected(client))
-		{
-			LOG_DBG("LTE connection lost, reconnecting...");
-			lte_lc_connect_async(lte_handler);
-			k_sem_take(&connected, K_FOREVER);
-		}
+		LOG_ERR("Power domain init, error: %d", err);
+	}
+#endif
 
-		/* Read sensor data and send it */
-		app_sensors_read_and_stream();
+#if defined(CONFIG_HARVEST_TRACKER)
+	err = harvest_init();
+	if (err)
+	{
+		LOG_ERR("Harvest tracker init, error: %d", err);
+	}
+#endif
+
+#if defined(CONFIG_SAMPLER)
+	sampler_start();
+#endif
 
-		/* Sleep before the next cycle */
-		k_sleep(K_SECONDS(get_loop_delay_s()));
+#if defined(CONFIG_SAMPLE_STORE)
+	err = sample_store_init();
+	if (err)
+	{
+		LOG_ERR("Sample store init, error: %d", err);
 	}
+#endif
+
+	boot_timing_mark(BOOT_PHASE_INIT_DONE);
+
+	/* From here on, all application work runs as jobs on this thread */
+	startup_reported = resumed;
+	radio_window_register(RADIO_INTENT_UPLINK, sensor_uplink);
+	jobs_register(JOB_SENSORS, sensor_job);
+	jobs_schedule(JOB_SENSORS, 0);
+	IF_ENABLED(CONFIG_LOCATION_TRACKING, (location_tracking_init();));
+	IF_ENABLED(CONFIG_HIBERNATE, (jobs_set_idle_hook(idle_hook);));
+
+	jobs_run();
+
+	return 0;
 }
@@ -5,5 +5,3 @@
  */
 
 extern struct golioth_client *client;
-
-void wake_system_thread(void);
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(motion, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include "motion.h"
+#include "power_domain.h"
+
+static const struct device *const accel = DEVICE_DT_GET_ANY(st_lis2dh);
+
+static motion_handler_fn motion_handler;
+
+static void motion_trigger_handler(const struct device *dev,
+				   const struct sensor_trigger *trig)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(trig);
+
+	if (motion_handler) {
+		motion_handler();
+	}
+}
+
+static int motion_arm(void)
+{
+	static const struct sensor_trigger trig = {
+		.type = SENSOR_TRIG_DELTA,
+		.chan = SENSOR_CHAN_ACCEL_XYZ,
+	};
+	struct sensor_value val;
+	int err;
+
+	val.val1 = CONFIG_LOCATION_MOTION_ODR_HZ;
+	val.val2 = 0;
+	err = sensor_attr_set(accel, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_SAMPLING_FREQUENCY, &val);
+	if (err) {
+		LOG_ERR("Unable to set the accelerometer rate: %d", err);
+		return err;
+	}
+
+	/* The threshold is in m/s^2 */
+	sensor_value_from_micro(&val, (int64_t)CONFIG_LOCATION_MOTION_THRESHOLD_MG * SENSOR_G /
+					      1000);
+	err = sensor_attr_set(accel, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_SLOPE_TH, &val);
+	if (err) {
+		LOG_ERR("Unable to set the motion threshold: %d", err);
+		return err;
+	}
+
+	val.val1 = CONFIG_LOCATION_MOTION_DURATION;
+	val.val2 = 0;
+	err = sensor_attr_set(accel, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_SLOPE_DUR, &val);
+	if (err) {
+		LOG_ERR("Unable to set the motion duration: %d", err);
+		return err;
+	}
+
+	err = sensor_trigger_set(accel, &trig, motion_trigger_handler);
+	if (err) {
+		LOG_ERR("Unable to arm the motion interrupt: %d", err);
+	}
+
+	return err;
+}
+
+int motion_init(motion_handler_fn handler)
+{
+	int err;
+
+	if (accel == NULL || !device_is_ready(accel)) {
+		LOG_WRN("No accelerometer");
+		return -ENODEV;
+	}
+
+#if defined(CONFIG_POWER_DOMAIN_MANAGER)
+	/* The interrupt only works while the sensor is powered, so the rail
+	 * stays on for good. It was off since boot; motion_arm() programs
+	 * the sensor again.
+	 */
+	err = power_domain_get(POWER_DOMAIN_3V3);
+	if (err) {
+		return err;
+	}
+#endif
+
+	motion_handler = handler;
+
+	err = motion_arm();
+	if (err) {
+		motion_handler = NULL;
+		IF_ENABLED(CONFIG_POWER_DOMAIN_MANAGER, (power_domain_put(POWER_DOMAIN_3V3);));
+		return err;
+	}
+
+	LOG_INF("Wake-on-motion armed");
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __MOTION_H__
+#define __MOTION_H__
+
+/** Wake-on-motion from the LIS2DH accelerometer.
+ *
+ * The accelerometer runs on its own in low-power mode at
+ * `CONFIG_LOCATION_MOTION_ODR_HZ` and raises its activity interrupt when
+ * the acceleration changes by more than `CONFIG_LOCATION_MOTION_THRESHOLD_MG`
+ * for `CONFIG_LOCATION_MOTION_DURATION` samples. Nothing is polled: the
+ * MCU only runs the handler, from the sensor trigger thread, when the
+ * device moves.
+ */
+
+/* Called from the sensor trigger thread */
+typedef void (*motion_handler_fn)(void);
+
+/* Returns 0 once the interrupt is armed, otherwise there is no motion input */
+int motion_init(motion_handler_fn handler);
+
+#endif /* __MOTION_H__ */
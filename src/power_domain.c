@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(power_domain, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/regulator.h>
+#include <zephyr/pm/device.h>
+#include <zephyr/pm/device_runtime.h>
+#include "power_domain.h"
+
+#define ZEPHYR_USER DT_PATH(zephyr_user)
+
+#if DT_NODE_HAS_PROP(ZEPHYR_USER, rail_3v3_devices)
+#define RAIL_3V3_DEVICE(node_id, prop, idx) DEVICE_DT_GET(DT_PHANDLE_BY_IDX(node_id, prop, idx))
+
+static const struct device *const rail_3v3_devices[] = {
+	DT_FOREACH_PROP_ELEM_SEP(ZEPHYR_USER, rail_3v3_devices, RAIL_3V3_DEVICE, (,))
+};
+#else
+static const struct device *const rail_3v3_devices[0];
+#endif
+
+struct power_domain_rail {
+	const struct device *regulator;
+	const struct device *const *devices;
+	size_t num_devices;
+	uint32_t settle_ms;
+	uint32_t users;
+	uint32_t suspended_users;	/* Users when power_domain_off_all() ran */
+};
+
+static struct power_domain_rail rails[POWER_DOMAIN_COUNT] = {
+	[POWER_DOMAIN_3V3] = {
+		.regulator = DEVICE_DT_GET(DT_NODELABEL(reg_3v3)),
+		.devices = rail_3v3_devices,
+		.num_devices = ARRAY_SIZE(rail_3v3_devices),
+		.settle_ms = CONFIG_POWER_DOMAIN_3V3_SETTLE_MS,
+	},
+};
+
+/* Serializes rail switching, a get may sleep for the settle time */
+static K_MUTEX_DEFINE(power_domain_lock);
+
+static void device_action(const struct device *dev, enum pm_device_action action)
+{
+#if defined(CONFIG_PM_DEVICE)
+	int err = pm_device_action_run(dev, action);
+
+	/* Devices without PM support, or already in that state, are fine */
+	if (err && err != -ENOSYS && err != -ENOTSUP && err != -EALREADY) {
+		LOG_WRN("%s: PM action %d failed: %d", dev->name, action, err);
+	}
+#endif
+}
+
+static void devices_resume(const struct power_domain_rail *rail)
+{
+	for (size_t i = 0; i < rail->num_devices; i++) {
+		const struct device *dev = rail->devices[i];
+		int err;
+
+		device_action(dev, PM_DEVICE_ACTION_TURN_ON);
+
+		err = pm_device_runtime_get(dev);
+		if (err) {
+			LOG_WRN("%s: resume failed: %d", dev->name, err);
+		}
+	}
+}
+
+/* Runtime PM references are only dropped when the window held them */
+static void devices_suspend(const struct power_domain_rail *rail, bool release)
+{
+	for (size_t i = 0; i < rail->num_devices; i++) {
+		const struct device *dev = rail->devices[i];
+		int err;
+
+		if (release) {
+			err = pm_device_runtime_put(dev);
+			if (err) {
+				LOG_WRN("%s: suspend failed: %d", dev->name, err);
+			}
+		}
+
+		device_action(dev, PM_DEVICE_ACTION_TURN_OFF);
+	}
+}
+
+static int rail_on(struct power_domain_rail *rail)
+{
+	int err;
+
+	err = regulator_enable(rail->regulator);
+	if (err) {
+		LOG_ERR("%s: enable failed: %d", rail->regulator->name, err);
+		return err;
+	}
+
+	k_msleep(rail->settle_ms);
+	devices_resume(rail);
+
+	return 0;
+}
+
+static void rail_off(struct power_domain_rail *rail, bool release)
+{
+	int err;
+
+	devices_suspend(rail, release);
+
+	err = regulator_disable(rail->regulator);
+	if (err) {
+		LOG_ERR("%s: disable failed: %d", rail->regulator->name, err);
+	}
+}
+
+int power_domain_get(enum power_domain domain)
+{
+	struct power_domain_rail *rail;
+	int err = 0;
+
+	if (domain >= POWER_DOMAIN_COUNT) {
+		return -EINVAL;
+	}
+
+	rail = &rails[domain];
+
+	k_mutex_lock(&power_domain_lock, K_FOREVER);
+
+	if (rail->users == 0) {
+		err = rail_on(rail);
+	}
+	if (!err) {
+		rail->users++;
+	}
+
+	k_mutex_unlock(&power_domain_lock);
+
+	return err;
+}
+
+int power_domain_put(enum power_domain domain)
+{
+	struct power_domain_rail *rail;
+
+	if (domain >= POWER_DOMAIN_COUNT) {
+		return -EINVAL;
+	}
+
+	rail = &rails[domain];
+
+	k_mutex_lock(&power_domain_lock, K_FOREVER);
+
+	if (rail->users == 0) {
+		k_mutex_unlock(&power_domain_lock);
+		LOG_WRN("Unbalanced put on power domain %d", domain);
+		return -EALREADY;
+	}
+
+	if (--rail->users == 0) {
+		rail_off(rail, true);
+	}
+
+	k_mutex_unlock(&power_domain_lock);
+
+	return 0;
+}
+
+void power_domain_off_all(void)
+{
+	k_mutex_lock(&power_domain_lock, K_FOREVER);
+
+	for (int i = 0; i < POWER_DOMAIN_COUNT; i++) {
+		rails[i].suspended_users = rails[i].users;
+		if (rails[i].users > 0) {
+			LOG_WRN("Power domain %d forced off with %u users", i, rails[i].users);
+			rails[i].users = 0;
+			rail_off(&rails[i], true);
+		}
+	}
+
+	k_mutex_unlock(&power_domain_lock);
+}
+
+void power_domain_restore_all(void)
+{
+	k_mutex_lock(&power_domain_lock, K_FOREVER);
+
+	for (int i = 0; i < POWER_DOMAIN_COUNT; i++) {
+		struct power_domain_rail *rail = &rails[i];
+
+		if (rail->suspended_users > 0 && rail->users == 0 && !rail_on(rail)) {
+			rail->users = rail->suspended_users;
+		}
+		rail->suspended_users = 0;
+	}
+
+	k_mutex_unlock(&power_domain_lock);
+}
+
+/* Rails start off: a rail the board enabled at boot is released here, and
+ * devices on it are told their supply is gone.
+ */
+int power_domain_init(void)
+{
+	for (int i = 0; i < POWER_DOMAIN_COUNT; i++) {
+		struct power_domain_rail *rail = &rails[i];
+
+		if (!device_is_ready(rail->regulator)) {
+			LOG_ERR("%s not ready", rail->regulator->name);
+			return -ENODEV;
+		}
+
+		if (regulator_is_enabled(rail->regulator)) {
+			rail_off(rail, false);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __POWER_DOMAIN_H__
+#define __POWER_DOMAIN_H__
+
+/** Peripheral power-domain manager.
+ *
+ * The external sensors sit on the 3V3 rail supplied by the nPM1300 BUCK2
+ * (`reg_3v3`). The rail is off between acquisition windows and is switched
+ * on by the first `power_domain_get()` and off by the last
+ * `power_domain_put()`. Switching on waits
+ * `CONFIG_POWER_DOMAIN_3V3_SETTLE_MS` for the rail to settle before the
+ * devices on it are resumed.
+ *
+ * Devices on the rail are listed in the `rail-3v3-devices` phandle array of
+ * the devicetree `zephyr,user` node. They are sent `PM_DEVICE_ACTION_TURN_ON`
+ * once the rail is up and get a device runtime PM reference for the window,
+ * and are released and sent `PM_DEVICE_ACTION_TURN_OFF` before it goes down.
+ */
+
+#include <stdbool.h>
+
+enum power_domain {
+	POWER_DOMAIN_3V3,
+	POWER_DOMAIN_COUNT,
+};
+
+int power_domain_init(void);
+int power_domain_get(enum power_domain domain);
+int power_domain_put(enum power_domain domain);
+/* Drops every reference and switches all domains off, e.g. before hibernate */
+void power_domain_off_all(void);
+/* Undoes power_domain_off_all() when the power down did not happen */
+void power_domain_restore_all(void);
+
+#endif /* __POWER_DOMAIN_H__ */
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(psm, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <modem/lte_lc.h>
+#include "jobs.h"
+#include "psm.h"
+
+static struct k_spinlock lock;
+
+/* Granted by the network, -1 while unknown or PSM is not granted */
+static int granted_tau_s = -1;
+/* Uptime at the last RRC release, where T3412 starts; 0 while unknown */
+static int64_t idle_since_ms;
+
+static int requested_tau_s;
+
+/* Returns delay_s, or less when that rides the next TAU wake */
+static uint32_t psm_align_s(uint32_t delay_s)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int tau_s = granted_tau_s;
+	int64_t idle_ms = idle_since_ms;
+	int64_t tau_in_s;
+	uint32_t advance_max_s;
+
+	k_spin_unlock(&lock, key);
+
+	if (tau_s <= 0 || idle_ms == 0) {
+		return delay_s;
+	}
+
+	/* The TAU timer only runs out when no uplink restarts it first */
+	tau_in_s = (idle_ms + (int64_t)tau_s * MSEC_PER_SEC - k_uptime_get()) / MSEC_PER_SEC;
+	if (tau_in_s <= CONFIG_PSM_ALIGN_LEAD_SECONDS || delay_s <= tau_in_s) {
+		return delay_s;
+	}
+
+	advance_max_s = delay_s * CONFIG_PSM_ALIGN_MAX_ADVANCE_PCT / 100;
+	if (delay_s - (tau_in_s - CONFIG_PSM_ALIGN_LEAD_SECONDS) > advance_max_s) {
+		/* Too far ahead, pay for the TAU rather than the early cycle */
+		return delay_s;
+	}
+
+	LOG_DBG("Uplink moved from %u s to %lld s, before the TAU", delay_s,
+		tau_in_s - CONFIG_PSM_ALIGN_LEAD_SECONDS);
+
+	return tau_in_s - CONFIG_PSM_ALIGN_LEAD_SECONDS;
+}
+
+/* The RRC release restarts T3412, so the sensor cycle is aligned to the
+ * TAU that follows this release, once the window's traffic is over.
+ */
+static void sensor_cycle_align(void)
+{
+	uint32_t due_s = jobs_next_due_s(JOB_SENSORS);
+	uint32_t aligned_s;
+
+	if (due_s == UINT32_MAX) {
+		return;
+	}
+
+	aligned_s = psm_align_s(due_s);
+	if (aligned_s < due_s) {
+		jobs_schedule(JOB_SENSORS, aligned_s);
+	}
+}
+
+static void lte_psm_evt_handler(const struct lte_lc_evt *const evt)
+{
+	k_spinlock_key_t key;
+
+	switch (evt->type) {
+	case LTE_LC_EVT_PSM_UPDATE:
+		key = k_spin_lock(&lock);
+		granted_tau_s = evt->psm_cfg.tau;
+		k_spin_unlock(&lock, key);
+
+		LOG_INF("Granted TAU %d s, active time %d s (requested TAU %d s)",
+			evt->psm_cfg.tau, evt->psm_cfg.active_time, requested_tau_s);
+		break;
+	case LTE_LC_EVT_RRC_UPDATE:
+		if (evt->rrc_mode == LTE_LC_RRC_MODE_IDLE) {
+			key = k_spin_lock(&lock);
+			idle_since_ms = k_uptime_get();
+			k_spin_unlock(&lock, key);
+			sensor_cycle_align();
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static int tau_for_interval_s(uint32_t loop_delay_s)
+{
+	uint64_t tau_s = (uint64_t)loop_delay_s * (100 + CONFIG_PSM_TAU_MARGIN_PCT) / 100;
+
+	return CLAMP(tau_s, CONFIG_PSM_TAU_MIN_SECONDS, CONFIG_PSM_TAU_MAX_SECONDS);
+}
+
+static int psm_request(uint32_t loop_delay_s)
+{
+	int tau_s = tau_for_interval_s(loop_delay_s);
+	int err;
+
+	if (tau_s == requested_tau_s) {
+		return 0;
+	}
+
+	err = lte_lc_psm_param_set_seconds(tau_s, CONFIG_PSM_ACTIVE_TIME_SECONDS);
+	if (err) {
+		LOG_ERR("Unable to set PSM parameters: %d", err);
+		return err;
+	}
+
+	/* Sent to the network with the next attach or TAU */
+	err = lte_lc_psm_req(true);
+	if (err) {
+		LOG_ERR("Unable to request PSM: %d", err);
+		return err;
+	}
+
+	requested_tau_s = tau_s;
+	LOG_INF("Requested TAU %d s, active time %d s", tau_s, CONFIG_PSM_ACTIVE_TIME_SECONDS);
+
+	return 0;
+}
+
+void psm_loop_delay_update(uint32_t loop_delay_s)
+{
+	psm_request(loop_delay_s);
+}
+
+int psm_init(uint32_t loop_delay_s)
+{
+	lte_lc_register_handler(lte_psm_evt_handler);
+
+	return psm_request(loop_delay_s);
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __PSM_H__
+#define __PSM_H__
+
+/** PSM timer coordinator.
+ *
+ * The modem wakes from PSM for a periodic tracking area update (TAU) when
+ * the network-granted TAU timer (T3412) runs out. Any uplink restarts that
+ * timer, so an uplink sent just before the TAU replaces it, while one sent
+ * just after it costs a second wake.
+ *
+ * The coordinator requests a TAU a little longer than `LOOP_DELAY_S`, so
+ * regular uplinks normally keep the TAU from firing at all, and asks for
+ * it again whenever the setting changes. It records the TAU and active
+ * time the network actually granted. Each time the modem goes to RRC idle,
+ * where T3412 restarts, the next sensor cycle (see jobs.h) is moved to just
+ * before the next TAU when it would otherwise land shortly after it.
+ */
+
+#include <stdint.h>
+
+int psm_init(uint32_t loop_delay_s);
+/* Requests a TAU that covers the new interval */
+void psm_loop_delay_update(uint32_t loop_delay_s);
+
+#endif /* __PSM_H__ */
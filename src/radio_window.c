@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(radio_window, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include "conn_mgr.h"
+#include "radio_window.h"
+
+/* Intents that need the Golioth connection */
+#define CONNECTED_INTENTS (BIT_MASK(RADIO_INTENT_COUNT) & ~BIT(RADIO_INTENT_CELL_MEAS))
+
+static radio_intent_fn intents[RADIO_INTENT_COUNT];
+static atomic_t pending;
+
+void radio_window_register(enum radio_intent intent, radio_intent_fn fn)
+{
+	intents[intent] = fn;
+}
+
+void radio_window_request(enum radio_intent intent)
+{
+	atomic_or(&pending, BIT(intent));
+}
+
+/* Takes the first pending intent in mask, or returns RADIO_INTENT_COUNT */
+static enum radio_intent take_next(atomic_val_t mask)
+{
+	atomic_val_t current = atomic_get(&pending) & mask;
+
+	if (current == 0) {
+		return RADIO_INTENT_COUNT;
+	}
+
+	enum radio_intent next = find_lsb_set(current) - 1;
+
+	atomic_and(&pending, ~BIT(next));
+
+	return next;
+}
+
+static void run_intent(enum radio_intent intent, bool online)
+{
+	if (intents[intent]) {
+		intents[intent](online);
+	}
+}
+
+void radio_window_run(uint32_t idle_s)
+{
+	enum radio_intent intent;
+	atomic_val_t batch;
+	int err;
+
+	while ((intent = take_next(BIT(RADIO_INTENT_CELL_MEAS))) != RADIO_INTENT_COUNT) {
+		run_intent(intent, false);
+	}
+
+	if ((atomic_get(&pending) & CONNECTED_INTENTS) == 0) {
+		return;
+	}
+
+	err = conn_mgr_acquire();
+	if (err) {
+		/* Each intent keeps its data for a later window */
+		LOG_INF("Offline (%s), error: %d", conn_mgr_state_str(conn_mgr_state()), err);
+	}
+
+	/* Taken at once: an intent that requests itself again from its
+	 * callback, e.g. while offline, waits for the next window.
+	 */
+	batch = atomic_and(&pending, ~CONNECTED_INTENTS) & CONNECTED_INTENTS;
+
+	while (batch) {
+		intent = find_lsb_set(batch) - 1;
+		batch &= ~BIT(intent);
+		run_intent(intent, err == 0);
+	}
+
+	if (!err) {
+		conn_mgr_release(idle_s);
+	}
+}
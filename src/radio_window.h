@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __RADIO_WINDOW_H__
+#define __RADIO_WINDOW_H__
+
+/** Shared radio window.
+ *
+ * Jobs do not use the radio themselves. They register an intent with
+ * `radio_window_request()`, and after each batch of jobs (see jobs.h) all
+ * pending intents run back to back, in the order of `enum radio_intent`:
+ *
+ *   1. The neighbor cell measurement, before the connection is set up,
+ *      since the modem measures best in RRC idle.
+ *   2. The connection is acquired once (see conn_mgr.h).
+ *   3. Sensor uplink, location request, LightDB state sync and the energy
+ *      report.
+ *   4. The connection is released with the time until the next job.
+ *
+ * All the traffic of a cycle thus shares one RRC connection and one
+ * inactivity tail. An intent requested during the measurement, e.g. a
+ * location request that follows it, joins the same window; one requested
+ * by a connected intent waits for the next window.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum radio_intent {
+	RADIO_INTENT_CELL_MEAS,		/* Runs before connecting */
+	RADIO_INTENT_UPLINK,
+	RADIO_INTENT_LOCATION,
+	RADIO_INTENT_STATE_SYNC,
+	RADIO_INTENT_ENERGY_REPORT,
+	RADIO_INTENT_COUNT,
+};
+
+/* online: the Golioth connection is up; always false for the measurement */
+typedef void (*radio_intent_fn)(bool online);
+
+void radio_window_register(enum radio_intent intent, radio_intent_fn fn);
+/* Callable from any context */
+void radio_window_request(enum radio_intent intent);
+/* Runs the pending intents, idle_s is the time until the next window */
+void radio_window_run(uint32_t idle_s);
+
+#endif /* __RADIO_WINDOW_H__ */
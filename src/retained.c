@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(retained, LOG_LEVEL_DBG);
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/crc.h>
+#include "retained.h"
+
+#define RETAINED_MAGIC     0x52544e31 /* "RTN1" */
+#define SETTINGS_SUBTREE   "retained"
+#define SETTINGS_KEY       SETTINGS_SUBTREE "/values"
+
+enum retained_type {
+	RETAINED_TYPE_U32,
+	RETAINED_TYPE_I32,
+};
+
+struct retained_entry {
+	enum retained_type type;
+	uint32_t def;
+};
+
+static const struct retained_entry registry[RETAINED_COUNT] = {
+	[RETAINED_BOOT_COUNT] = { RETAINED_TYPE_U32, 0 },
+	[RETAINED_TX_SUCCESS] = { RETAINED_TYPE_U32, 0 },
+	[RETAINED_TX_FAILURE] = { RETAINED_TYPE_U32, 0 },
+	[RETAINED_LOOP_DELAY_S] = { RETAINED_TYPE_I32, CONFIG_SENSOR_SAMPLE_INTERVAL_SECONDS },
+	[RETAINED_EXAMPLE_INT0] = { RETAINED_TYPE_U32, 0 },
+	[RETAINED_EXAMPLE_INT1] = { RETAINED_TYPE_U32, 1 },
+};
+
+struct retained_region {
+	uint32_t magic;
+	uint32_t count;
+	uint32_t crc;
+	uint32_t values[RETAINED_COUNT];
+};
+
+static __noinit struct retained_region region;
+/* Flash copy loaded by the settings handler */
+static uint32_t flash_values[RETAINED_COUNT];
+static bool flash_loaded;
+static bool initialized;
+
+static struct k_spinlock lock;
+
+#if defined(CONFIG_SETTINGS)
+static void flush_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(flush_work, flush_work_handler);
+
+#define schedule_flush() \
+	k_work_schedule(&flush_work, K_SECONDS(CONFIG_RETAINED_FLASH_INTERVAL_SECONDS))
+#else
+#define schedule_flush()
+#endif
+
+static uint32_t region_crc(void)
+{
+	return crc32_ieee((const uint8_t *)region.values, sizeof(region.values));
+}
+
+static bool region_is_valid(void)
+{
+	return region.magic == RETAINED_MAGIC && region.count == RETAINED_COUNT &&
+	       region.crc == region_crc();
+}
+
+static void region_seal(void)
+{
+	region.magic = RETAINED_MAGIC;
+	region.count = RETAINED_COUNT;
+	region.crc = region_crc();
+}
+
+#if defined(CONFIG_SETTINGS)
+static int retained_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+				 void *cb_arg)
+{
+	ssize_t ret;
+
+	if (strcmp(key, "values") != 0) {
+		return -ENOENT;
+	}
+
+	/* Entries are only ever appended, a shorter copy seeds the ones it has */
+	if (len > sizeof(flash_values) || len % sizeof(uint32_t) != 0) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < RETAINED_COUNT; i++) {
+		flash_values[i] = registry[i].def;
+	}
+
+	ret = read_cb(cb_arg, flash_values, len);
+	if (ret < 0) {
+		return (int)ret;
+	}
+
+	flash_loaded = true;
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(retained, SETTINGS_SUBTREE, NULL, retained_settings_set, NULL,
+			       NULL);
+
+void retained_flush(void)
+{
+	uint32_t values[RETAINED_COUNT];
+	int err;
+
+	k_work_cancel_delayable(&flush_work);
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	memcpy(values, region.values, sizeof(values));
+
+	k_spin_unlock(&lock, key);
+
+	err = settings_save_one(SETTINGS_KEY, values, sizeof(values));
+	if (err) {
+		LOG_ERR("Unable to save retained state: %d", err);
+	}
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+	retained_flush();
+}
+#else
+void retained_flush(void)
+{
+}
+#endif /* CONFIG_SETTINGS */
+
+static void set_raw(enum retained_id id, uint32_t value)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	bool changed = (region.values[id] != value);
+
+	region.values[id] = value;
+	region_seal();
+
+	k_spin_unlock(&lock, key);
+
+	/* Batches flash writes, a pending flush is not pushed back */
+	if (changed) {
+		schedule_flush();
+	}
+}
+
+static uint32_t get_raw(enum retained_id id)
+{
+	uint32_t value;
+
+	if (!initialized) {
+		return registry[id].def;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	value = region.values[id];
+
+	k_spin_unlock(&lock, key);
+
+	return value;
+}
+
+uint32_t retained_get_u32(enum retained_id id)
+{
+	__ASSERT_NO_MSG(id < RETAINED_COUNT && registry[id].type == RETAINED_TYPE_U32);
+
+	return get_raw(id);
+}
+
+int32_t retained_get_i32(enum retained_id id)
+{
+	__ASSERT_NO_MSG(id < RETAINED_COUNT && registry[id].type == RETAINED_TYPE_I32);
+
+	return (int32_t)get_raw(id);
+}
+
+void retained_set_u32(enum retained_id id, uint32_t value)
+{
+	__ASSERT_NO_MSG(id < RETAINED_COUNT && registry[id].type == RETAINED_TYPE_U32);
+
+	set_raw(id, value);
+}
+
+void retained_set_i32(enum retained_id id, int32_t value)
+{
+	__ASSERT_NO_MSG(id < RETAINED_COUNT && registry[id].type == RETAINED_TYPE_I32);
+
+	set_raw(id, (uint32_t)value);
+}
+
+uint32_t retained_inc(enum retained_id id)
+{
+	uint32_t value;
+
+	__ASSERT_NO_MSG(id < RETAINED_COUNT && registry[id].type == RETAINED_TYPE_U32);
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	value = ++region.values[id];
+	region_seal();
+
+	k_spin_unlock(&lock, key);
+
+	schedule_flush();
+
+	return value;
+}
+
+int retained_init(void)
+{
+	if (region_is_valid()) {
+		LOG_INF("Using retained state from RAM");
+	} else {
+#if defined(CONFIG_SETTINGS)
+		int err = settings_subsys_init();
+
+		if (!err) {
+			err = settings_load_subtree(SETTINGS_SUBTREE);
+		}
+		if (err) {
+			LOG_WRN("Unable to load retained state: %d", err);
+		}
+#endif
+
+		for (size_t i = 0; i < RETAINED_COUNT; i++) {
+			region.values[i] = flash_loaded ? flash_values[i] : registry[i].def;
+		}
+		region_seal();
+
+		LOG_INF("Retained state %s",
+			flash_loaded ? "restored from flash" : "set to defaults");
+	}
+
+	initialized = true;
+
+	LOG_INF("Boot count: %u", retained_inc(RETAINED_BOOT_COUNT));
+
+	return 0;
+}
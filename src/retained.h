@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __RETAINED_H__
+#define __RETAINED_H__
+
+/** Retained application state.
+ *
+ * Counters and settings that must survive a reset are kept in a typed
+ * registry instead of plain statics. The values live in a `__noinit` RAM
+ * region guarded by a magic, the registry layout and a CRC, which survives
+ * warm resets and most brownouts. Changes are also written to the settings
+ * partition at most every `CONFIG_RETAINED_FLASH_INTERVAL_SECONDS`, and on
+ * `retained_flush()`. At boot a valid RAM region is used as is; otherwise,
+ * e.g. on a cold power-on, the flash copy is loaded, and entries without
+ * one start from their defaults.
+ *
+ * Each entry has a fixed type; use the accessor matching it.
+ */
+
+#include <stdint.h>
+
+enum retained_id {
+	RETAINED_BOOT_COUNT,		/* u32: boots since the first power-on */
+	RETAINED_TX_SUCCESS,		/* u32: uplinks accepted */
+	RETAINED_TX_FAILURE,		/* u32: uplinks that failed */
+	RETAINED_LOOP_DELAY_S,		/* i32: LOOP_DELAY_S setting */
+	RETAINED_EXAMPLE_INT0,		/* u32: example_int0 state */
+	RETAINED_EXAMPLE_INT1,		/* u32: example_int1 state */
+	RETAINED_COUNT,
+};
+
+int retained_init(void);
+uint32_t retained_get_u32(enum retained_id id);
+int32_t retained_get_i32(enum retained_id id);
+void retained_set_u32(enum retained_id id, uint32_t value);
+void retained_set_i32(enum retained_id id, int32_t value);
+uint32_t retained_inc(enum retained_id id);
+/* Writes pending changes to flash now, e.g. before a power down */
+void retained_flush(void);
+
+#endif /* __RETAINED_H__ */
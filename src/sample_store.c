@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sample_store, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/storage/flash_map.h>
+#include "sample_store.h"
+
+#define SAMPLE_STORE_PARTITION sample_storage
+
+/* NVS record holding the ring head/tail, samples use the IDs after it */
+#define META_ID       0
+#define SLOT_ID_BASE  1
+
+BUILD_ASSERT(CONFIG_SAMPLE_STORE_CAPACITY + SLOT_ID_BASE <= UINT16_MAX,
+	     "Sample store capacity exceeds the NVS ID range");
+
+/* head and tail are free-running sequence numbers, the slot is seq % capacity */
+struct sample_store_meta {
+	uint32_t head;
+	uint32_t tail;
+};
+
+static struct nvs_fs fs = {
+	.flash_device = FIXED_PARTITION_DEVICE(SAMPLE_STORE_PARTITION),
+	.offset = FIXED_PARTITION_OFFSET(SAMPLE_STORE_PARTITION),
+};
+
+static struct sample_store_meta meta;
+static bool initialized;
+static K_MUTEX_DEFINE(store_lock);
+
+static inline uint16_t slot_id(uint32_t seq)
+{
+	return SLOT_ID_BASE + (seq % CONFIG_SAMPLE_STORE_CAPACITY);
+}
+
+static inline uint32_t count_get(void)
+{
+	return meta.head - meta.tail;
+}
+
+static int meta_write(void)
+{
+	ssize_t ret = nvs_write(&fs, META_ID, &meta, sizeof(meta));
+
+	return (ret < 0) ? (int)ret : 0;
+}
+
+int sample_store_init(void)
+{
+	struct flash_pages_info info;
+	ssize_t ret;
+	int err;
+
+	if (!device_is_ready(fs.flash_device)) {
+		LOG_ERR("Flash device not ready");
+		return -ENODEV;
+	}
+
+	err = flash_get_page_info_by_offs(fs.flash_device, fs.offset, &info);
+	if (err) {
+		LOG_ERR("Unable to get flash page info: %d", err);
+		return err;
+	}
+
+	fs.sector_size = info.size;
+	fs.sector_count = FIXED_PARTITION_SIZE(SAMPLE_STORE_PARTITION) / info.size;
+
+	err = nvs_mount(&fs);
+	if (err) {
+		LOG_ERR("Unable to mount sample store: %d", err);
+		return err;
+	}
+
+	ret = nvs_read(&fs, META_ID, &meta, sizeof(meta));
+	if (ret != sizeof(meta) || count_get() > CONFIG_SAMPLE_STORE_CAPACITY) {
+		LOG_INF("No valid sample store found, starting empty");
+		meta.head = 0;
+		meta.tail = 0;
+	}
+
+	initialized = true;
+	LOG_INF("Sample store ready, %u queued samples", count_get());
+
+	return 0;
+}
+
+int sample_store_push(const struct sensor_sample *sample)
+{
+	ssize_t ret;
+	int err;
+
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	if (count_get() >= CONFIG_SAMPLE_STORE_CAPACITY) {
+		/* Evict the oldest sample, its slot is overwritten below */
+		meta.tail++;
+		LOG_WRN("Sample store full, dropped oldest sample");
+	}
+
+	ret = nvs_write(&fs, slot_id(meta.head), sample, sizeof(*sample));
+	if (ret < 0) {
+		LOG_ERR("Failed to write sample: %d", (int)ret);
+		err = (int)ret;
+		goto unlock;
+	}
+
+	meta.head++;
+	err = meta_write();
+	if (err) {
+		LOG_ERR("Failed to update sample store: %d", err);
+	}
+
+	LOG_DBG("Stored sample, %u queued", count_get());
+
+unlock:
+	k_mutex_unlock(&store_lock);
+
+	return err;
+}
+
+int sample_store_peek(size_t index, struct sensor_sample *sample)
+{
+	ssize_t ret;
+	int err = 0;
+
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	if (index >= count_get()) {
+		err = -ENOENT;
+		goto unlock;
+	}
+
+	ret = nvs_read(&fs, slot_id(meta.tail + index), sample, sizeof(*sample));
+	if (ret != sizeof(*sample)) {
+		/* Missing, or written by a firmware with a different layout */
+		err = (ret < 0) ? (int)ret : -EBADMSG;
+	}
+
+unlock:
+	k_mutex_unlock(&store_lock);
+
+	return err;
+}
+
+int sample_store_pop(size_t count)
+{
+	int err;
+
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	meta.tail += MIN(count, count_get());
+	err = meta_write();
+
+	k_mutex_unlock(&store_lock);
+
+	return err;
+}
+
+size_t sample_store_count(void)
+{
+	size_t count;
+
+	if (!initialized) {
+		return 0;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+	count = count_get();
+	k_mutex_unlock(&store_lock);
+
+	return count;
+}
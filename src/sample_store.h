@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __SAMPLE_STORE_H__
+#define __SAMPLE_STORE_H__
+
+/** Flash-backed store-and-forward queue for sensor samples.
+ *
+ * Samples taken while the device has no connection to Golioth are kept in a
+ * ring of `CONFIG_SAMPLE_STORE_CAPACITY` NVS records on the `sample_storage`
+ * partition and uploaded oldest-first at the next connection. When the ring
+ * is full the oldest sample is evicted. Each sample costs a single NVS write
+ * plus a small head/tail record, and NVS spreads these writes over all
+ * sectors of the partition, so flash wear is bounded by the sample rate.
+ */
+
+#include <stddef.h>
+#include "app_sensors.h"
+
+int sample_store_init(void);
+int sample_store_push(const struct sensor_sample *sample);
+int sample_store_peek(size_t index, struct sensor_sample *sample);
+int sample_store_pop(size_t count);
+size_t sample_store_count(void);
+
+#endif /* __SAMPLE_STORE_H__ */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sampler, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/spsc_lockfree.h>
+#include "fuel_gauge.h"
+#include "sampler.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_SAMPLER_RING_SIZE),
+	     "Sampler ring size must be a power of two");
+
+struct sampler_record {
+	float voltage;
+	float current;
+	float soc;
+};
+
+/* Written by the sampler work item only, read by the uplink path only */
+SPSC_DEFINE(sample_ring, struct sampler_record, CONFIG_SAMPLER_RING_SIZE);
+
+static atomic_t dropped;
+
+/* Reporting window accumulated from the ring, owned by the uplink path */
+static struct sample_summary window;
+static float sum_voltage;
+static float sum_current;
+static float sum_soc;
+
+static void field_add(struct field_stats *stats, float *sum, float value, bool first)
+{
+	if (first) {
+		stats->min = value;
+		stats->max = value;
+	} else {
+		stats->min = MIN(stats->min, value);
+		stats->max = MAX(stats->max, value);
+	}
+
+	stats->last = value;
+	*sum += value;
+}
+
+static void window_add(const struct sampler_record *record)
+{
+	bool first = (window.count == 0);
+
+	field_add(&window.voltage, &sum_voltage, record->voltage, first);
+	field_add(&window.current, &sum_current, record->current, first);
+	field_add(&window.soc, &sum_soc, record->soc, first);
+	window.count++;
+}
+
+void sampler_summary_get(struct sample_summary *summary)
+{
+	struct sampler_record *record;
+
+	while ((record = spsc_consume(&sample_ring)) != NULL) {
+		window_add(record);
+		spsc_release(&sample_ring);
+	}
+
+	window.dropped = (uint16_t)MIN(atomic_get(&dropped), UINT16_MAX);
+
+	if (window.count > 0) {
+		window.voltage.mean = sum_voltage / window.count;
+		window.current.mean = sum_current / window.count;
+		window.soc.mean = sum_soc / window.count;
+	}
+
+	*summary = window;
+}
+
+void sampler_summary_reset(void)
+{
+	memset(&window, 0, sizeof(window));
+	sum_voltage = 0.f;
+	sum_current = 0.f;
+	sum_soc = 0.f;
+	atomic_clear(&dropped);
+}
+
+static void sampler_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct battery_data batt_data;
+	struct sampler_record *record;
+
+	get_battery_data(&batt_data);
+
+	record = spsc_acquire(&sample_ring);
+	if (record) {
+		record->voltage = batt_data.voltage;
+		record->current = batt_data.current;
+		record->soc = batt_data.soc;
+		spsc_produce(&sample_ring);
+	} else {
+		/* The uplink path has not drained the ring this window */
+		atomic_inc(&dropped);
+	}
+
+	k_work_schedule(dwork, K_SECONDS(CONFIG_SAMPLER_INTERVAL_SECONDS));
+}
+
+static K_WORK_DELAYABLE_DEFINE(sampler_work, sampler_work_handler);
+
+/* Called once the fuel gauge is initialized */
+void sampler_start(void)
+{
+	LOG_INF("Sampling every %d s", CONFIG_SAMPLER_INTERVAL_SECONDS);
+
+	k_work_schedule(&sampler_work, K_NO_WAIT);
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+/** Background sampling of the supercapacitor state.
+ *
+ * A delayable work item on the system workqueue reads the fuel gauge every
+ * `CONFIG_SAMPLER_INTERVAL_SECONDS` and pushes a fixed-size record into a
+ * single-producer/single-consumer lock-free ring. The uplink path calls
+ * `sampler_summary_get()` to fold the ring into min/max/mean/last per field
+ * over the current reporting window, and `sampler_summary_reset()` once that
+ * window has been reported. This gives sub-hourly visibility of the energy
+ * store without sub-hourly uplinks.
+ */
+
+#include <stdint.h>
+
+struct field_stats {
+	float min;
+	float max;
+	float mean;
+	float last;
+};
+
+struct sample_summary {
+	uint16_t count;
+	uint16_t dropped;
+	struct field_stats voltage;
+	struct field_stats current;
+	struct field_stats soc;
+};
+
+void sampler_start(void);
+void sampler_summary_get(struct sample_summary *summary);
+void sampler_summary_reset(void);
+
+#endif /* __SAMPLER_H__ */
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(scheduler, LOG_LEVEL_DBG);
+
+#include <math.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include "app_settings.h"
+#include "scheduler.h"
+#include "supercap.h"
+#include "harvest.h"
+
+#define SOC_HYSTERESIS_PCT ((float)CONFIG_ENERGY_SCHEDULER_SOC_HYSTERESIS_PCT)
+#define HARVEST_CURRENT_A  ((float)CONFIG_ENERGY_SCHEDULER_HARVEST_CURRENT_MA / 1000.f)
+
+/* Last tier picked, used to apply hysteresis on the SoC thresholds */
+static enum scheduler_tier current_tier = SCHEDULER_TIER_NORMAL;
+
+static const uint8_t tier_interval_pct[] = {
+	[SCHEDULER_TIER_CRITICAL] = CONFIG_ENERGY_SCHEDULER_CRITICAL_INTERVAL_PCT,
+	[SCHEDULER_TIER_LOW] = CONFIG_ENERGY_SCHEDULER_LOW_INTERVAL_PCT,
+	[SCHEDULER_TIER_NORMAL] = CONFIG_ENERGY_SCHEDULER_NORMAL_INTERVAL_PCT,
+	[SCHEDULER_TIER_HARVEST] = CONFIG_ENERGY_SCHEDULER_HARVEST_INTERVAL_PCT,
+};
+
+const char *scheduler_tier_str(enum scheduler_tier tier)
+{
+	switch (tier) {
+	case SCHEDULER_TIER_CRITICAL:
+		return "critical";
+	case SCHEDULER_TIER_LOW:
+		return "low";
+	case SCHEDULER_TIER_NORMAL:
+		return "normal";
+	case SCHEDULER_TIER_HARVEST:
+		return "harvest";
+	}
+
+	return "unknown";
+}
+
+/* Leaving a tier upwards requires the SoC to clear the threshold by the
+ * hysteresis margin, so a reading hovering around a threshold does not make
+ * the interval flap between two values.
+ */
+static bool soc_below(float soc, float threshold, enum scheduler_tier tier)
+{
+	if (current_tier <= tier) {
+		threshold += SOC_HYSTERESIS_PCT;
+	}
+
+	return soc < threshold;
+}
+
+static bool is_harvesting(const struct battery_data *batt)
+{
+	/* Charging current is reported as negative */
+	return batt->current <= -HARVEST_CURRENT_A;
+}
+
+#if defined(CONFIG_SUPERCAP_MODEL)
+static float energy_level_pct(const struct battery_data *batt)
+{
+	struct supercap_estimate estimate;
+
+	supercap_estimate_get(&estimate);
+
+	return estimate.usable_pct;
+}
+
+static bool energy_runs_out_soon(const struct battery_data *batt)
+{
+	struct supercap_estimate estimate;
+
+	supercap_estimate_get(&estimate);
+
+	return estimate.cycles_left < CONFIG_ENERGY_SCHEDULER_CRITICAL_CYCLES;
+}
+#else
+static float energy_level_pct(const struct battery_data *batt)
+{
+	return batt->soc;
+}
+
+static bool energy_runs_out_soon(const struct battery_data *batt)
+{
+	/* TTE is NaN while charging or when the gauge has no estimate yet */
+	return !isnan(batt->tte) &&
+	       batt->tte < (float)CONFIG_ENERGY_SCHEDULER_TTE_CRITICAL_SECONDS;
+}
+#endif /* CONFIG_SUPERCAP_MODEL */
+
+enum scheduler_tier scheduler_tier_current(void)
+{
+	return current_tier;
+}
+
+void scheduler_tier_restore(enum scheduler_tier tier)
+{
+	if (tier <= SCHEDULER_TIER_HARVEST) {
+		current_tier = tier;
+	}
+}
+
+enum scheduler_tier scheduler_tier_get(const struct battery_data *batt)
+{
+	enum scheduler_tier tier;
+	float level = energy_level_pct(batt);
+
+	if (soc_below(level, CONFIG_ENERGY_SCHEDULER_CRITICAL_SOC_PCT,
+		      SCHEDULER_TIER_CRITICAL) || energy_runs_out_soon(batt)) {
+		tier = SCHEDULER_TIER_CRITICAL;
+	} else if (soc_below(level, CONFIG_ENERGY_SCHEDULER_LOW_SOC_PCT,
+			     SCHEDULER_TIER_LOW)) {
+		tier = SCHEDULER_TIER_LOW;
+	} else if (is_harvesting(batt)) {
+		tier = SCHEDULER_TIER_HARVEST;
+	} else {
+		tier = SCHEDULER_TIER_NORMAL;
+	}
+
+	if (tier != current_tier) {
+		LOG_INF("Energy tier changed: %s -> %s", scheduler_tier_str(current_tier),
+			scheduler_tier_str(tier));
+		current_tier = tier;
+	}
+
+	return tier;
+}
+
+int32_t scheduler_next_delay_s(const struct battery_data *batt)
+{
+	enum scheduler_tier tier = scheduler_tier_get(batt);
+	int32_t ceiling = get_loop_delay_s();
+	int32_t floor = MIN(ceiling, CONFIG_ENERGY_SCHEDULER_MIN_INTERVAL_SECONDS);
+	int32_t delay = (int32_t)(((int64_t)ceiling * tier_interval_pct[tier]) / 100);
+
+	delay = CLAMP(delay, floor, ceiling);
+
+	LOG_INF("Energy tier: %s (level: %.1f%%, I: %.3f A), next cycle in %d s",
+		scheduler_tier_str(tier), (double)energy_level_pct(batt), (double)batt->current,
+		delay);
+
+	return delay;
+}
+
+/* Non-urgent work waits for the next high-harvest window when it starts
+ * within CONFIG_HARVEST_MAX_DEFER_SECONDS, unless the panel is already
+ * charging or the harvest profile is not trusted yet.
+ */
+int32_t scheduler_defer_s(void)
+{
+#if defined(CONFIG_HARVEST_TRACKER)
+	struct battery_data batt;
+	int32_t wait_s;
+
+	get_battery_data(&batt);
+	if (is_harvesting(&batt)) {
+		return 0;
+	}
+
+	wait_s = harvest_seconds_to_window();
+	if (wait_s <= 0 || wait_s > CONFIG_HARVEST_MAX_DEFER_SECONDS) {
+		return 0;
+	}
+
+	return wait_s;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+/** Energy-aware sampling scheduler.
+ *
+ * Picks the delay before the next sample/uplink cycle from the energy state
+ * reported by the fuel gauge. The `LOOP_DELAY_S` value received from the
+ * Golioth Settings Service (see app_settings.h) is used as the ceiling: a
+ * device low on energy runs at that interval, and the interval is tightened
+ * as the state of charge rises or while the solar panel is harvesting.
+ *
+ * The energy level is the fuel gauge SoC, or the usable supercapacitor energy
+ * when `CONFIG_SUPERCAP_MODEL` is enabled (see supercap.h). Tier thresholds
+ * and per-tier intervals are set in Kconfig (`CONFIG_ENERGY_SCHEDULER_*`).
+ *
+ * With `CONFIG_HARVEST_TRACKER`, `scheduler_defer_s()` tells callers of
+ * non-urgent radio work (batch uplinks, location fixes) how long to wait for
+ * the next predicted high-harvest window (see harvest.h).
+ */
+
+#include <stdint.h>
+#include "fuel_gauge.h"
+
+enum scheduler_tier {
+	SCHEDULER_TIER_CRITICAL,
+	SCHEDULER_TIER_LOW,
+	SCHEDULER_TIER_NORMAL,
+	SCHEDULER_TIER_HARVEST,
+};
+
+enum scheduler_tier scheduler_tier_get(const struct battery_data *batt);
+const char *scheduler_tier_str(enum scheduler_tier tier);
+int32_t scheduler_next_delay_s(const struct battery_data *batt);
+int32_t scheduler_defer_s(void);
+/* Last tier picked, carried across a hibernate so hysteresis still applies */
+enum scheduler_tier scheduler_tier_current(void);
+void scheduler_tier_restore(enum scheduler_tier tier);
+
+#endif /* __SCHEDULER_H__ */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(supercap, LOG_LEVEL_DBG);
+
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/util.h>
+#include "supercap.h"
+
+#define CAPACITANCE_F   ((float)CONFIG_SUPERCAP_CAPACITANCE_F)
+#define MAX_V           ((float)CONFIG_SUPERCAP_MAX_MV / 1000.f)
+#define CUTOFF_V        ((float)CONFIG_SUPERCAP_CUTOFF_MV / 1000.f)
+#define CYCLE_ALPHA     ((float)CONFIG_SUPERCAP_CYCLE_EWMA_PCT / 100.f)
+
+BUILD_ASSERT(CONFIG_SUPERCAP_MAX_MV > CONFIG_SUPERCAP_CUTOFF_MV,
+	     "Supercap maximum voltage must be above the cutoff voltage");
+
+static struct k_spinlock lock;
+static float voltage;
+static float cycle_j = (float)CONFIG_SUPERCAP_CYCLE_ENERGY_MJ / 1000.f;
+/* Discharge energy integrated since the current cycle started */
+static float cycle_discharge_j;
+static int64_t last_update;
+
+static float energy_above_cutoff(float v)
+{
+	if (v <= CUTOFF_V) {
+		return 0.f;
+	}
+
+	return 0.5f * CAPACITANCE_F * (v * v - CUTOFF_V * CUTOFF_V);
+}
+
+void supercap_update(const struct battery_data *batt)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (last_update && batt->current > 0.f) {
+		/* Discharge current is positive, charging is negative */
+		float dt = (float)(batt->timestamp - last_update) / 1000.f;
+
+		cycle_discharge_j += batt->voltage * batt->current * dt;
+	}
+
+	voltage = batt->voltage;
+	last_update = batt->timestamp;
+
+	k_spin_unlock(&lock, key);
+}
+
+void supercap_cycle_mark(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	float measured = cycle_discharge_j;
+
+	/* A cycle spent entirely on harvested energy tells nothing about cost */
+	if (measured > 0.f) {
+		cycle_j = CYCLE_ALPHA * measured + (1.f - CYCLE_ALPHA) * cycle_j;
+	}
+	cycle_discharge_j = 0.f;
+
+	k_spin_unlock(&lock, key);
+
+	LOG_DBG("Cycle discharge: %.3f J, learned cycle cost: %.3f J", (double)measured,
+		(double)cycle_j);
+}
+
+void supercap_cycle_cost_set(float cycle_j_in)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (cycle_j_in > 0.f) {
+		cycle_j = cycle_j_in;
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+float supercap_energy_above(float floor_v)
+{
+	float energy;
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	energy = energy_above_cutoff(voltage) - energy_above_cutoff(floor_v);
+
+	k_spin_unlock(&lock, key);
+
+	return MAX(energy, 0.f);
+}
+
+void supercap_estimate_get(struct supercap_estimate *estimate)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	estimate->usable_j = energy_above_cutoff(voltage);
+	estimate->usable_pct = 100.f * estimate->usable_j / energy_above_cutoff(MAX_V);
+	estimate->usable_pct = CLAMP(estimate->usable_pct, 0.f, 100.f);
+	estimate->cycle_j = cycle_j;
+	estimate->cycles_left = (cycle_j > 0.f) ? (uint32_t)(estimate->usable_j / cycle_j) : 0;
+
+	k_spin_unlock(&lock, key);
+}
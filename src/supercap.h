@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025 Conexio Technologies, Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __SUPERCAP_H__
+#define __SUPERCAP_H__
+
+/** Supercapacitor energy model.
+ *
+ * The nRF Fuel Gauge tables model a Li-ion cell, which says little about a
+ * supercapacitor whose stored energy is simply 1/2 C V^2. This module reports
+ * the energy usable above the cutoff voltage (`CONFIG_SUPERCAP_CUTOFF_MV`)
+ * and how many sensor cycles that energy pays for.
+ *
+ * The cost of a cycle is learned: the discharge energy (V * I * dt) is
+ * integrated from every fuel gauge update, and at the end of each cycle the
+ * total is folded into an exponential moving average.
+ */
+
+#include <stdint.h>
+#include "fuel_gauge.h"
+
+struct supercap_estimate {
+	float usable_j;		/* Energy above the cutoff voltage */
+	float usable_pct;	/* usable_j relative to a full capacitor */
+	float cycle_j;		/* Learned energy per sensor cycle */
+	uint32_t cycles_left;	/* usable_j / cycle_j */
+};
+
+void supercap_update(const struct battery_data *batt);
+void supercap_cycle_mark(void);
+void supercap_estimate_get(struct supercap_estimate *estimate);
+/* Restores a learned cycle cost, e.g. after a hibernate */
+void supercap_cycle_cost_set(float cycle_j);
+/* Energy (J) stored above floor_v, which must not be below the cutoff */
+float supercap_energy_above(float floor_v);
+
+#endif /* __SUPERCAP_H__ */